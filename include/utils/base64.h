@@ -111,11 +111,45 @@ inline std::vector<std::byte> base64_decode(std::string_view encoded_string) {
 }
 
 namespace json {
+  template<typename Context>
+  struct serializer<std::span<const std::byte>, Context> {
+    json operator()(std::span<const std::byte> value) const {
+      return base64::base64_encode(value);
+    }
+
+    void write(string_writer &out, std::span<const std::byte> value) const {
+      out.write_string(base64::base64_encode(value));
+    }
+  };
+
+  template<> struct borrows_input<std::span<const std::byte>> : std::true_type {};
+
+  // The decoded bytes are stored in the reader's arena
+  template<typename Context>
+  struct deserializer<std::span<const std::byte>, Context> {
+    // Only declared to turn the json value entry points into a readable error
+    template<typename Json> requires std::same_as<std::remove_cvref_t<Json>, json>
+    std::span<const std::byte> operator()(Json &&) const {
+      static_assert(sizeof(Json) == 0, "std::span<const std::byte> is text-only: "
+        "deserialize it from a std::string_view, not from a json value");
+      return {};
+    }
+
+    std::span<const std::byte> read(string_reader &in) const {
+      auto bytes = base64::base64_decode(in.read_string());
+      return in.store_in_arena(bytes);
+    }
+  };
+
   template<typename Context>
   struct serializer<std::vector<std::byte>, Context> {
     json operator()(const std::vector<std::byte> &value) const {
       return base64::base64_encode(value);
     }
+
+    void write(string_writer &out, const std::vector<std::byte> &value) const {
+      out.write_string(base64::base64_encode(value));
+    }
   };
 
   template<typename Context>
@@ -126,6 +160,24 @@ namespace json {
       }
       return base64::base64_decode(value.get<std::string>());
     }
+
+    deserialize_result<std::vector<std::byte>> try_deserialize(const json &value) const {
+      if (!value.is_string()) {
+        return deserialize_failure{"", "Cannot deserialize base64 encoded string"};
+      }
+      return base64::base64_decode(value.get_ref<const json::string_t &>());
+    }
+
+    std::optional<deserialize_failure> validate(const json &value) const {
+      if (!value.is_string()) {
+        return deserialize_failure{"", "Cannot deserialize base64 encoded string"};
+      }
+      return std::nullopt;
+    }
+
+    std::vector<std::byte> read(string_reader &in) const {
+      return base64::base64_decode(in.read_string());
+    }
   };
 }
 
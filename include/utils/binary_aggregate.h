@@ -0,0 +1,66 @@
+#ifndef __BINARY_AGGREGATE_H__
+#define __BINARY_AGGREGATE_H__
+
+#include "binary_serial.h"
+#include "json_aggregate.h"
+
+namespace binary {
+
+    // Aggregates are packed as arrays in declaration order.
+    // Missing trailing members fall back to their default value, extra ones are skipped.
+
+    template<typename T, typename Context>
+    concept all_fields_serializable = json::aggregate<T> &&
+        []<size_t ... Is>(std::index_sequence<Is ...>) {
+            return (serializable<json::member_type<T, Is>, Context> && ...);
+        }(std::make_index_sequence<reflect::size<T>()>());
+
+    template<typename T, typename Context>
+    concept all_fields_deserializable = json::aggregate<T> &&
+        []<size_t ... Is>(std::index_sequence<Is ...>) {
+            return (deserializable<json::member_type<T, Is>, Context> && ...);
+        }(std::make_index_sequence<reflect::size<T>()>());
+
+    template<json::aggregate T, typename Context> requires all_fields_serializable<T, Context>
+    struct serializer<T, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        void operator()(packer &out, const T &value) const {
+            out.pack_array(reflect::size<T>());
+            [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                (this->pack_with_context(out, reflect::get<Is>(value)), ...);
+            }(std::make_index_sequence<reflect::size<T>()>());
+        }
+    };
+
+    template<json::aggregate T, typename Context> requires all_fields_deserializable<T, Context>
+    struct deserializer<T, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        template<size_t I>
+        json::member_type<T, I> unpack_field(unpacker &in, size_t size) const {
+            if (I < size) {
+                return this->template unpack_with_context<json::member_type<T, I>>(in);
+            } else {
+                return json::default_field<T, I>();
+            }
+        }
+
+        T operator()(unpacker &in) const {
+            if (!in.is_array()) {
+                throw std::runtime_error(fmt::format("Cannot deserialize {}: value is not an array", reflect::type_name<T>()));
+            }
+            size_t size = in.unpack_array();
+            T ret = [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                return T{ unpack_field<Is>(in, size) ... };
+            }(std::make_index_sequence<reflect::size<T>()>());
+            for (size_t i = reflect::size<T>(); i < size; ++i) {
+                in.skip();
+            }
+            return ret;
+        }
+    };
+
+}
+
+#endif
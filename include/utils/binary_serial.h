@@ -0,0 +1,624 @@
+#ifndef __BINARY_SERIAL_H__
+#define __BINARY_SERIAL_H__
+
+#include <fmt/format.h>
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Direct MessagePack encoder/decoder, mirroring the json serializer/deserializer traits
+
+namespace binary {
+
+    template<typename T>
+    concept is_complete = requires(T self) { sizeof(self); };
+
+    template<typename T, typename Context = void> struct serializer;
+
+    template<typename T, typename Context = void>
+    struct is_serializable : std::bool_constant<is_complete<serializer<T, Context>>> {};
+
+    template<typename T, typename Context = void>
+    concept serializable = is_serializable<T, Context>::value;
+
+    template<typename T, typename Context = void> struct deserializer;
+
+    template<typename T, typename Context = void>
+    struct is_deserializable : std::bool_constant<is_complete<deserializer<T, Context>>> {};
+
+    template<typename T, typename Context = void>
+    concept deserializable = is_deserializable<T, Context>::value;
+
+    struct deserialize_error : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    class packer {
+    private:
+        std::vector<std::byte> &m_buffer;
+
+        void put(uint8_t value) {
+            m_buffer.push_back(static_cast<std::byte>(value));
+        }
+
+        template<std::unsigned_integral T>
+        void put_big_endian(uint8_t type, T value) {
+            put(type);
+            for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+                put(static_cast<uint8_t>(value >> shift));
+            }
+        }
+
+        void put_header(size_t size, uint8_t fix_base, size_t fix_max, uint8_t type8, uint8_t type16, uint8_t type32) {
+            if (fix_base != 0 && size <= fix_max) {
+                put(static_cast<uint8_t>(fix_base | size));
+            } else if (type8 != 0 && size <= UINT8_MAX) {
+                put_big_endian(type8, static_cast<uint8_t>(size));
+            } else if (size <= UINT16_MAX) {
+                put_big_endian(type16, static_cast<uint16_t>(size));
+            } else {
+                put_big_endian(type32, static_cast<uint32_t>(size));
+            }
+        }
+
+    public:
+        explicit packer(std::vector<std::byte> &buffer) : m_buffer{buffer} {}
+
+        std::vector<std::byte> &buffer() const {
+            return m_buffer;
+        }
+
+        void pack_nil() {
+            put(0xc0);
+        }
+
+        void pack_bool(bool value) {
+            put(value ? 0xc3 : 0xc2);
+        }
+
+        void pack_uint(uint64_t value) {
+            if (value <= 0x7f) {
+                put(static_cast<uint8_t>(value));
+            } else if (value <= UINT8_MAX) {
+                put_big_endian(0xcc, static_cast<uint8_t>(value));
+            } else if (value <= UINT16_MAX) {
+                put_big_endian(0xcd, static_cast<uint16_t>(value));
+            } else if (value <= UINT32_MAX) {
+                put_big_endian(0xce, static_cast<uint32_t>(value));
+            } else {
+                put_big_endian(0xcf, value);
+            }
+        }
+
+        void pack_int(int64_t value) {
+            if (value >= 0) {
+                pack_uint(static_cast<uint64_t>(value));
+            } else if (value >= -32) {
+                put(static_cast<uint8_t>(value));
+            } else if (value >= INT8_MIN) {
+                put_big_endian(0xd0, static_cast<uint8_t>(value));
+            } else if (value >= INT16_MIN) {
+                put_big_endian(0xd1, static_cast<uint16_t>(value));
+            } else if (value >= INT32_MIN) {
+                put_big_endian(0xd2, static_cast<uint32_t>(value));
+            } else {
+                put_big_endian(0xd3, static_cast<uint64_t>(value));
+            }
+        }
+
+        void pack_float(float value) {
+            put_big_endian(0xca, std::bit_cast<uint32_t>(value));
+        }
+
+        void pack_double(double value) {
+            put_big_endian(0xcb, std::bit_cast<uint64_t>(value));
+        }
+
+        template<typename T> requires std::is_arithmetic_v<T>
+        void pack_number(T value) {
+            if constexpr (std::is_same_v<T, bool>) {
+                pack_bool(value);
+            } else if constexpr (std::is_same_v<T, float>) {
+                pack_float(value);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                pack_double(static_cast<double>(value));
+            } else if constexpr (std::is_signed_v<T>) {
+                pack_int(value);
+            } else {
+                pack_uint(value);
+            }
+        }
+
+        void pack_str(std::string_view value) {
+            put_header(value.size(), 0xa0, 31, 0xd9, 0xda, 0xdb);
+            auto bytes = std::as_bytes(std::span(value));
+            m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end());
+        }
+
+        void pack_bin(std::span<const std::byte> value) {
+            put_header(value.size(), 0, 0, 0xc4, 0xc5, 0xc6);
+            m_buffer.insert(m_buffer.end(), value.begin(), value.end());
+        }
+
+        void pack_array(size_t size) {
+            put_header(size, 0x90, 15, 0, 0xdc, 0xdd);
+        }
+
+        void pack_map(size_t size) {
+            put_header(size, 0x80, 15, 0, 0xde, 0xdf);
+        }
+    };
+
+    class unpacker {
+    private:
+        std::span<const std::byte> m_data;
+        size_t m_pos = 0;
+
+        [[noreturn]] void error(std::string_view message) const {
+            throw std::runtime_error(fmt::format("{} at offset {}", message, m_pos));
+        }
+
+        uint8_t peek_byte() const {
+            if (m_pos >= m_data.size()) {
+                error("Unexpected end of input");
+            }
+            return static_cast<uint8_t>(m_data[m_pos]);
+        }
+
+        uint8_t get() {
+            uint8_t value = peek_byte();
+            ++m_pos;
+            return value;
+        }
+
+        uint64_t get_big_endian(size_t size) {
+            if (m_pos + size > m_data.size()) {
+                error("Unexpected end of input");
+            }
+            uint64_t value = 0;
+            for (size_t i=0; i<size; ++i) {
+                value = (value << 8) | static_cast<uint8_t>(m_data[m_pos++]);
+            }
+            return value;
+        }
+
+        std::span<const std::byte> get_bytes(size_t size) {
+            if (m_pos + size > m_data.size()) {
+                error("Unexpected end of input");
+            }
+            auto ret = m_data.subspan(m_pos, size);
+            m_pos += size;
+            return ret;
+        }
+
+        // Reads any integer format, returns true if the value is negative
+        bool get_integer(uint64_t &value) {
+            uint8_t type = peek_byte();
+            if (type <= 0x7f) {
+                value = get();
+                return false;
+            } else if (type >= 0xe0) {
+                value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(get())));
+                return true;
+            }
+            switch (type) {
+            case 0xcc: case 0xcd: case 0xce: case 0xcf:
+                ++m_pos;
+                value = get_big_endian(size_t(1) << (type - 0xcc));
+                return false;
+            case 0xd0: ++m_pos; value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(get_big_endian(1)))); break;
+            case 0xd1: ++m_pos; value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int16_t>(get_big_endian(2)))); break;
+            case 0xd2: ++m_pos; value = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(get_big_endian(4)))); break;
+            case 0xd3: ++m_pos; value = get_big_endian(8); break;
+            default:
+                error("Cannot deserialize integer");
+            }
+            return static_cast<int64_t>(value) < 0;
+        }
+
+    public:
+        explicit unpacker(std::span<const std::byte> data) : m_data{data} {}
+
+        size_t position() const {
+            return m_pos;
+        }
+
+        bool at_end() const {
+            return m_pos >= m_data.size();
+        }
+
+        size_t remaining() const {
+            return m_data.size() - m_pos;
+        }
+
+        bool is_nil() const {
+            return peek_byte() == 0xc0;
+        }
+
+        bool is_array() const {
+            uint8_t type = peek_byte();
+            return (type >= 0x90 && type <= 0x9f) || type == 0xdc || type == 0xdd;
+        }
+
+        void unpack_nil() {
+            if (get() != 0xc0) {
+                error("Expected nil");
+            }
+        }
+
+        bool unpack_bool() {
+            switch (peek_byte()) {
+            case 0xc2: ++m_pos; return false;
+            case 0xc3: ++m_pos; return true;
+            default: error("Cannot deserialize boolean");
+            }
+        }
+
+        template<typename T> requires std::is_arithmetic_v<T>
+        T unpack_number() {
+            if constexpr (std::is_same_v<T, bool>) {
+                return unpack_bool();
+            } else if constexpr (std::is_floating_point_v<T>) {
+                switch (peek_byte()) {
+                case 0xca:
+                    ++m_pos;
+                    return static_cast<T>(std::bit_cast<float>(static_cast<uint32_t>(get_big_endian(4))));
+                case 0xcb:
+                    ++m_pos;
+                    return static_cast<T>(std::bit_cast<double>(get_big_endian(8)));
+                default: {
+                    uint64_t value;
+                    if (get_integer(value)) {
+                        return static_cast<T>(static_cast<int64_t>(value));
+                    } else {
+                        return static_cast<T>(value);
+                    }
+                }
+                }
+            } else {
+                uint64_t value;
+                bool negative = get_integer(value);
+                if (negative) {
+                    if constexpr (std::is_unsigned_v<T>) {
+                        error("Cannot deserialize unsigned integer: value is negative");
+                    } else if (static_cast<int64_t>(value) < std::numeric_limits<T>::min()) {
+                        error("Cannot deserialize integer: value out of range");
+                    }
+                    return static_cast<T>(static_cast<int64_t>(value));
+                } else if (value > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+                    error("Cannot deserialize integer: value out of range");
+                }
+                return static_cast<T>(value);
+            }
+        }
+
+        // The returned view points into the input buffer
+        std::string_view unpack_str() {
+            uint8_t type = peek_byte();
+            size_t size;
+            if (type >= 0xa0 && type <= 0xbf) {
+                ++m_pos;
+                size = type & 0x1f;
+            } else if (type >= 0xd9 && type <= 0xdb) {
+                ++m_pos;
+                size = get_big_endian(size_t(1) << (type - 0xd9));
+            } else {
+                error("Cannot deserialize string");
+            }
+            auto bytes = get_bytes(size);
+            return std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+        }
+
+        // The returned span points into the input buffer
+        std::span<const std::byte> unpack_bin() {
+            uint8_t type = peek_byte();
+            if (type < 0xc4 || type > 0xc6) {
+                error("Cannot deserialize binary");
+            }
+            ++m_pos;
+            return get_bytes(get_big_endian(size_t(1) << (type - 0xc4)));
+        }
+
+        size_t unpack_array() {
+            uint8_t type = peek_byte();
+            if (type >= 0x90 && type <= 0x9f) {
+                ++m_pos;
+                return type & 0x0f;
+            } else if (type == 0xdc || type == 0xdd) {
+                ++m_pos;
+                return get_big_endian(type == 0xdc ? 2 : 4);
+            }
+            error("Expected array");
+        }
+
+        size_t unpack_map() {
+            uint8_t type = peek_byte();
+            if (type >= 0x80 && type <= 0x8f) {
+                ++m_pos;
+                return type & 0x0f;
+            } else if (type == 0xde || type == 0xdf) {
+                ++m_pos;
+                return get_big_endian(type == 0xde ? 2 : 4);
+            }
+            error("Expected map");
+        }
+
+        // Iterative, so that deeply nested input cannot exhaust the stack.
+        // Containers have no end marker, so counting the values left to skip is enough.
+        void skip() {
+            for (size_t pending = 1; pending != 0; --pending) {
+                uint8_t type = peek_byte();
+                if (type <= 0x7f || type >= 0xe0 || type == 0xc0 || type == 0xc2 || type == 0xc3) {
+                    ++m_pos;
+                } else if ((type >= 0xa0 && type <= 0xbf) || (type >= 0xd9 && type <= 0xdb)) {
+                    unpack_str();
+                } else if (type >= 0xc4 && type <= 0xc6) {
+                    unpack_bin();
+                } else if ((type >= 0x90 && type <= 0x9f) || type == 0xdc || type == 0xdd) {
+                    pending += unpack_array();
+                } else if ((type >= 0x80 && type <= 0x8f) || type == 0xde || type == 0xdf) {
+                    pending += 2 * unpack_map();
+                } else if (type >= 0xcc && type <= 0xcf) {
+                    ++m_pos;
+                    get_bytes(size_t(1) << (type - 0xcc));
+                } else if (type >= 0xd0 && type <= 0xd3) {
+                    ++m_pos;
+                    get_bytes(size_t(1) << (type - 0xd0));
+                } else if (type == 0xca || type == 0xcb) {
+                    ++m_pos;
+                    get_bytes(type == 0xca ? 4 : 8);
+                } else if (type >= 0xd4 && type <= 0xd8) {
+                    ++m_pos;
+                    get_bytes(1 + (size_t(1) << (type - 0xd4)));
+                } else if (type >= 0xc7 && type <= 0xc9) {
+                    ++m_pos;
+                    size_t size = get_big_endian(size_t(1) << (type - 0xc7));
+                    get_bytes(1 + size);
+                } else {
+                    error("Invalid type");
+                }
+            }
+        }
+    };
+
+    template<typename Context>
+    struct context_holder {
+        const Context &context;
+
+        context_holder(const Context &context) : context(context) {}
+
+        template<serializable<Context> T>
+        void pack_with_context(packer &out, const T &value) const {
+            if constexpr (requires { serializer<T, Context>{context}; }) {
+                serializer<T, Context>{context}(out, value);
+            } else {
+                serializer<T, void>{}(out, value);
+            }
+        }
+
+        template<deserializable<Context> T>
+        T unpack_with_context(unpacker &in) const {
+            if constexpr (requires { deserializer<T, Context>{context}; }) {
+                return deserializer<T, Context>{context}(in);
+            } else {
+                return deserializer<T, void>{}(in);
+            }
+        }
+    };
+
+    template<> struct context_holder<void> {
+        template<serializable T>
+        void pack_with_context(packer &out, const T &value) const {
+            serializer<T, void>{}(out, value);
+        }
+
+        template<deserializable T>
+        T unpack_with_context(unpacker &in) const {
+            return deserializer<T, void>{}(in);
+        }
+    };
+
+    template<typename T> requires serializable<T>
+    void serialize_to(std::vector<std::byte> &buffer, const T &value) {
+        packer out{buffer};
+        context_holder<void>{}.pack_with_context(out, value);
+    }
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    void serialize_to(std::vector<std::byte> &buffer, const T &value, const Context &context) {
+        packer out{buffer};
+        context_holder<Context>{context}.pack_with_context(out, value);
+    }
+
+    template<typename T> requires serializable<T>
+    std::vector<std::byte> serialize(const T &value) {
+        std::vector<std::byte> ret;
+        serialize_to(ret, value);
+        return ret;
+    }
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    std::vector<std::byte> serialize(const T &value, const Context &context) {
+        std::vector<std::byte> ret;
+        serialize_to(ret, value, context);
+        return ret;
+    }
+
+    template<typename T> requires deserializable<T>
+    T deserialize(std::span<const std::byte> data) {
+        try {
+            unpacker in{data};
+            T ret = context_holder<void>{}.template unpack_with_context<T>(in);
+            if (!in.at_end()) {
+                throw std::runtime_error("Unexpected trailing bytes");
+            }
+            return ret;
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    T deserialize(std::span<const std::byte> data, const Context &context) {
+        try {
+            unpacker in{data};
+            T ret = context_holder<Context>{context}.template unpack_with_context<T>(in);
+            if (!in.at_end()) {
+                throw std::runtime_error("Unexpected trailing bytes");
+            }
+            return ret;
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    template<typename T, typename Context> requires std::is_arithmetic_v<T>
+    struct serializer<T, Context> {
+        void operator()(packer &out, const T &value) const {
+            out.pack_number(value);
+        }
+    };
+
+    template<typename Context>
+    struct serializer<std::string, Context> {
+        void operator()(packer &out, const std::string &value) const {
+            out.pack_str(value);
+        }
+    };
+
+    template<typename Context>
+    struct serializer<std::string_view, Context> {
+        void operator()(packer &out, std::string_view value) const {
+            out.pack_str(value);
+        }
+    };
+
+    template<typename Context>
+    struct serializer<std::span<const std::byte>, Context> {
+        void operator()(packer &out, std::span<const std::byte> value) const {
+            out.pack_bin(value);
+        }
+    };
+
+    template<typename Context>
+    struct serializer<std::vector<std::byte>, Context> {
+        void operator()(packer &out, const std::vector<std::byte> &value) const {
+            out.pack_bin(value);
+        }
+    };
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    struct serializer<std::vector<T>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        void operator()(packer &out, const std::vector<T> &value) const {
+            out.pack_array(value.size());
+            for (const T &obj : value) {
+                this->pack_with_context(out, obj);
+            }
+        }
+    };
+
+    template<typename Rep, typename Period, typename Context>
+    struct serializer<std::chrono::duration<Rep, Period>, Context> {
+        void operator()(packer &out, const std::chrono::duration<Rep, Period> &value) const {
+            out.pack_number(value.count());
+        }
+    };
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    struct serializer<std::optional<T>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        void operator()(packer &out, const std::optional<T> &value) const {
+            if (value) {
+                this->pack_with_context(out, *value);
+            } else {
+                out.pack_nil();
+            }
+        }
+    };
+
+    template<typename T, typename Context> requires std::is_arithmetic_v<T>
+    struct deserializer<T, Context> {
+        T operator()(unpacker &in) const {
+            return in.unpack_number<T>();
+        }
+    };
+
+    template<typename Context>
+    struct deserializer<std::string, Context> {
+        std::string operator()(unpacker &in) const {
+            return std::string(in.unpack_str());
+        }
+    };
+
+    // Borrows from the input buffer, which must outlive the result
+    template<typename Context>
+    struct deserializer<std::string_view, Context> {
+        std::string_view operator()(unpacker &in) const {
+            return in.unpack_str();
+        }
+    };
+
+    // Borrows from the input buffer, which must outlive the result
+    template<typename Context>
+    struct deserializer<std::span<const std::byte>, Context> {
+        std::span<const std::byte> operator()(unpacker &in) const {
+            return in.unpack_bin();
+        }
+    };
+
+    template<typename Context>
+    struct deserializer<std::vector<std::byte>, Context> {
+        std::vector<std::byte> operator()(unpacker &in) const {
+            auto bytes = in.unpack_bin();
+            return std::vector<std::byte>(bytes.begin(), bytes.end());
+        }
+    };
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    struct deserializer<std::vector<T>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        std::vector<T> operator()(unpacker &in) const {
+            size_t size = in.unpack_array();
+            std::vector<T> ret;
+            ret.reserve(std::min(size, in.remaining()));
+            for (size_t i=0; i<size; ++i) {
+                ret.push_back(this->template unpack_with_context<T>(in));
+            }
+            return ret;
+        }
+    };
+
+    template<typename Rep, typename Period, typename Context>
+    struct deserializer<std::chrono::duration<Rep, Period>, Context> {
+        std::chrono::duration<Rep, Period> operator()(unpacker &in) const {
+            return std::chrono::duration<Rep, Period>{in.unpack_number<Rep>()};
+        }
+    };
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    struct deserializer<std::optional<T>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        std::optional<T> operator()(unpacker &in) const {
+            if (in.is_nil()) {
+                in.unpack_nil();
+                return std::nullopt;
+            } else {
+                return this->template unpack_with_context<T>(in);
+            }
+        }
+    };
+}
+
+#endif
@@ -61,6 +61,10 @@ namespace enums {
         constexpr bool check(bitset value) const {
             return (m_value & value.m_value) == m_value;
         }
+
+        constexpr bitset_int to_int() const {
+            return m_value;
+        }
     };
 
 }
@@ -78,6 +82,16 @@ namespace json {
             }
             return ret;
         }
+
+        void write(string_writer &out, const enums::bitset<T> &value) const {
+            out.begin_array();
+            for (T v : enums::enum_values<T>()) {
+                if (value.check(v)) {
+                    out.write_string(enums::to_string(v));
+                }
+            }
+            out.end_array();
+        }
     };
 
     template<enums::enumeral T, typename Context>
@@ -92,6 +106,42 @@ namespace json {
             }
             return ret;
         }
+
+        deserialize_result<enums::bitset<T>> try_deserialize(const json &value) const {
+            if (!value.is_array()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {} bitset: value is not an array", reflect::type_name<T>())};
+            }
+            enums::bitset<T> ret;
+            for (size_t i=0; i<value.size(); ++i) {
+                auto result = deserializer<T, Context>{}.try_deserialize(value[i]);
+                if (!result) {
+                    return std::move(result).error().prepend_path(i);
+                }
+                ret.add(*result);
+            }
+            return ret;
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_array()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {} bitset: value is not an array", reflect::type_name<T>())};
+            }
+            for (size_t i=0; i<value.size(); ++i) {
+                if (auto error = deserializer<T, Context>{}.validate(value[i])) {
+                    return std::move(*error).prepend_path(i);
+                }
+            }
+            return std::nullopt;
+        }
+
+        enums::bitset<T> read(string_reader &in) const {
+            enums::bitset<T> ret;
+            in.begin_array();
+            while (in.next_element()) {
+                ret.add(deserializer<T, Context>{}.read(in));
+            }
+            return ret;
+        }
     };
 
 }
@@ -0,0 +1,466 @@
+#ifndef __ENUM_MAP_H__
+#define __ENUM_MAP_H__
+
+#include "enums.h"
+#include "json_serial.h"
+
+#include <bitset>
+#include <memory>
+
+namespace enums {
+
+    // Fixed-size array holding one value for every enumerator of E, indexed through indexof
+    template<enumeral E, typename V>
+    class enum_array {
+    public:
+        static constexpr size_t static_size = enum_values<E>().size();
+
+        using key_type = E;
+        using value_type = V;
+        using iterator = typename std::array<V, static_size>::iterator;
+        using const_iterator = typename std::array<V, static_size>::const_iterator;
+
+    private:
+        std::array<V, static_size> m_values{};
+
+    public:
+        constexpr enum_array() = default;
+
+        constexpr enum_array(std::initializer_list<std::pair<E, V>> values) {
+            for (const auto &[key, value] : values) {
+                m_values[indexof(key)] = value;
+            }
+        }
+
+        constexpr V &operator[](E key) { return m_values[indexof(key)]; }
+        constexpr const V &operator[](E key) const { return m_values[indexof(key)]; }
+
+        constexpr void fill(const V &value) { m_values.fill(value); }
+
+        static constexpr size_t size() { return static_size; }
+
+        static constexpr const auto &keys() { return enum_values<E>(); }
+
+        // Iterates the values in enum order, use keys() for the matching enumerators
+        constexpr iterator begin() { return m_values.begin(); }
+        constexpr iterator end() { return m_values.end(); }
+        constexpr const_iterator begin() const { return m_values.begin(); }
+        constexpr const_iterator end() const { return m_values.end(); }
+
+        constexpr bool operator == (const enum_array &other) const = default;
+    };
+
+    // Map from the enumerators of E to V, stored inline in enum order with an occupancy bitset
+    template<enumeral E, typename V>
+    class enum_map {
+    public:
+        static constexpr size_t static_size = enum_values<E>().size();
+
+        using key_type = E;
+        using mapped_type = V;
+
+    private:
+        alignas(V) std::byte m_storage[sizeof(V) * std::max<size_t>(static_size, 1)];
+        std::bitset<static_size> m_occupied;
+
+        V *slot(size_t index) {
+            return std::launder(reinterpret_cast<V *>(m_storage) + index);
+        }
+
+        const V *slot(size_t index) const {
+            return std::launder(reinterpret_cast<const V *>(m_storage) + index);
+        }
+
+        template<bool Const>
+        class basic_iterator {
+        private:
+            using map_type = std::conditional_t<Const, const enum_map, enum_map>;
+
+            map_type *m_map = nullptr;
+            size_t m_index = 0;
+
+            void skip_empty() {
+                while (m_index < static_size && !m_map->m_occupied[m_index]) {
+                    ++m_index;
+                }
+            }
+
+            friend class enum_map;
+
+            basic_iterator(map_type *map, size_t index) : m_map{map}, m_index{index} {
+                skip_empty();
+            }
+
+        public:
+            // operator * returns a proxy pair by value, which legacy forward iterators don't allow
+            using iterator_category = std::input_iterator_tag;
+            using iterator_concept = std::forward_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using value_type = std::pair<E, V>;
+            using reference = std::pair<E, std::conditional_t<Const, const V &, V &>>;
+
+            basic_iterator() = default;
+
+            reference operator *() const {
+                return { enum_values<E>()[m_index], *m_map->slot(m_index) };
+            }
+
+            basic_iterator &operator ++() {
+                ++m_index;
+                skip_empty();
+                return *this;
+            }
+
+            basic_iterator operator ++(int) {
+                basic_iterator tmp = *this;
+                ++(*this);
+                return tmp;
+            }
+
+            bool operator == (const basic_iterator &other) const {
+                return m_index == other.m_index;
+            }
+        };
+
+    public:
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        enum_map() = default;
+
+        enum_map(std::initializer_list<std::pair<E, V>> values) {
+            for (const auto &[key, value] : values) {
+                insert_or_assign(key, value);
+            }
+        }
+
+        enum_map(const enum_map &other) {
+            for (const auto &[key, value] : other) {
+                emplace(key, value);
+            }
+        }
+
+        enum_map(enum_map &&other) noexcept(std::is_nothrow_move_constructible_v<V>) {
+            for (auto &&[key, value] : other) {
+                emplace(key, std::move(value));
+            }
+        }
+
+        enum_map &operator = (const enum_map &other) {
+            if (this != &other) {
+                clear();
+                for (const auto &[key, value] : other) {
+                    emplace(key, value);
+                }
+            }
+            return *this;
+        }
+
+        enum_map &operator = (enum_map &&other) noexcept(std::is_nothrow_move_constructible_v<V>) {
+            if (this != &other) {
+                clear();
+                for (auto &&[key, value] : other) {
+                    emplace(key, std::move(value));
+                }
+            }
+            return *this;
+        }
+
+        ~enum_map() {
+            clear();
+        }
+
+        bool contains(E key) const {
+            return m_occupied[indexof(key)];
+        }
+
+        V *find(E key) {
+            size_t index = indexof(key);
+            return m_occupied[index] ? slot(index) : nullptr;
+        }
+
+        const V *find(E key) const {
+            size_t index = indexof(key);
+            return m_occupied[index] ? slot(index) : nullptr;
+        }
+
+        V &at(E key) {
+            if (V *value = find(key)) {
+                return *value;
+            }
+            throw std::out_of_range(fmt::format("enum_map::at: missing key {}", to_string(key)));
+        }
+
+        const V &at(E key) const {
+            if (const V *value = find(key)) {
+                return *value;
+            }
+            throw std::out_of_range(fmt::format("enum_map::at: missing key {}", to_string(key)));
+        }
+
+        V &operator[](E key) {
+            return emplace(key).first;
+        }
+
+        // Constructs the value in place if key is missing, like try_emplace
+        template<typename ... Args>
+        std::pair<V &, bool> emplace(E key, Args && ... args) {
+            size_t index = indexof(key);
+            if (m_occupied[index]) {
+                return { *slot(index), false };
+            }
+            V *value = std::construct_at(reinterpret_cast<V *>(m_storage) + index, std::forward<Args>(args) ...);
+            m_occupied.set(index);
+            return { *value, true };
+        }
+
+        template<typename T>
+        std::pair<V &, bool> insert_or_assign(E key, T &&value) {
+            auto ret = emplace(key, std::forward<T>(value));
+            if (!ret.second) {
+                ret.first = std::forward<T>(value);
+            }
+            return ret;
+        }
+
+        bool erase(E key) {
+            size_t index = indexof(key);
+            if (!m_occupied[index]) {
+                return false;
+            }
+            std::destroy_at(slot(index));
+            m_occupied.reset(index);
+            return true;
+        }
+
+        void clear() {
+            if constexpr (!std::is_trivially_destructible_v<V>) {
+                for (size_t i=0; i<static_size; ++i) {
+                    if (m_occupied[i]) {
+                        std::destroy_at(slot(i));
+                    }
+                }
+            }
+            m_occupied.reset();
+        }
+
+        size_t size() const {
+            return m_occupied.count();
+        }
+
+        bool empty() const {
+            return m_occupied.none();
+        }
+
+        // Iterates the present entries in enum order as (key, value) pairs
+        iterator begin() { return {this, 0}; }
+        iterator end() { return {this, static_size}; }
+        const_iterator begin() const { return {this, 0}; }
+        const_iterator end() const { return {this, static_size}; }
+
+        bool operator == (const enum_map &other) const requires std::equality_comparable<V> {
+            if (m_occupied != other.m_occupied) {
+                return false;
+            }
+            for (size_t i=0; i<static_size; ++i) {
+                if (m_occupied[i] && !(*slot(i) == *other.slot(i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+}
+
+namespace json {
+
+    template<enums::enumeral E, typename V> struct borrows_input<enums::enum_array<E, V>> : borrows_input<V> {};
+    template<enums::enumeral E, typename V> struct borrows_input<enums::enum_map<E, V>> : borrows_input<V> {};
+
+    namespace detail {
+        template<enums::enumeral E>
+        E enum_key(std::string_view key) {
+            if (auto value = enums::from_string<E>(key)) {
+                return *value;
+            }
+            throw std::runtime_error(fmt::format("Invalid {} value: {}", reflect::type_name<E>(), key));
+        }
+
+        template<enums::enumeral E>
+        deserialize_result<E> try_enum_key(std::string_view key) {
+            if (auto value = enums::from_string<E>(key)) {
+                return *value;
+            }
+            return deserialize_failure{"", fmt::format("Invalid {} value: {}", reflect::type_name<E>(), key)};
+        }
+    }
+
+    template<enums::enumeral E, typename V, typename Context> requires serializable<V, Context>
+    struct serializer<enums::enum_array<E, V>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        json operator()(const enums::enum_array<E, V> &values) const {
+            json ret = json::object();
+            for (E key : enums::enum_values<E>()) {
+                ret[json::string_t(enums::to_string(key))] = this->serialize_with_context(values[key]);
+            }
+            return ret;
+        }
+
+        void write(string_writer &out, const enums::enum_array<E, V> &values) const {
+            out.begin_object();
+            for (E key : enums::enum_values<E>()) {
+                out.key(enums::to_string(key));
+                this->write_with_context(out, values[key]);
+            }
+            out.end_object();
+        }
+    };
+
+    // Keys missing from the object keep their default value
+    template<enums::enumeral E, typename V, typename Context> requires deserializable<V, Context>
+    struct deserializer<enums::enum_array<E, V>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        enums::enum_array<E, V> operator()(const json &value) const {
+            if (!value.is_object()) {
+                throw std::runtime_error(fmt::format("Cannot deserialize {} array: value is not an object", reflect::type_name<E>()));
+            }
+            enums::enum_array<E, V> ret;
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                ret[detail::enum_key<E>(it.key())] = this->template deserialize_with_context<V>(it.value());
+            }
+            return ret;
+        }
+
+        deserialize_result<enums::enum_array<E, V>> try_deserialize(const json &value) const {
+            if (!value.is_object()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {} array: value is not an object", reflect::type_name<E>())};
+            }
+            enums::enum_array<E, V> ret;
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                auto key = detail::try_enum_key<E>(it.key());
+                if (!key) {
+                    return std::move(key).error();
+                }
+                auto result = this->template try_deserialize_with_context<V>(it.value());
+                if (!result) {
+                    return std::move(result).error().prepend_path(it.key());
+                }
+                ret[*key] = std::move(*result);
+            }
+            return ret;
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_object()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {} array: value is not an object", reflect::type_name<E>())};
+            }
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                if (auto key = detail::try_enum_key<E>(it.key()); !key) {
+                    return std::move(key).error();
+                }
+                if (auto error = this->template validate_with_context<V>(it.value())) {
+                    return std::move(*error).prepend_path(it.key());
+                }
+            }
+            return std::nullopt;
+        }
+
+        enums::enum_array<E, V> read(string_reader &in) const {
+            enums::enum_array<E, V> ret;
+            in.begin_object();
+            while (auto key = in.next_key()) {
+                E index = detail::enum_key<E>(*key);
+                ret[index] = this->template read_with_context<V>(in);
+            }
+            return ret;
+        }
+    };
+
+    template<enums::enumeral E, typename V, typename Context> requires serializable<V, Context>
+    struct serializer<enums::enum_map<E, V>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        json operator()(const enums::enum_map<E, V> &values) const {
+            json ret = json::object();
+            for (const auto &[key, value] : values) {
+                ret[json::string_t(enums::to_string(key))] = this->serialize_with_context(value);
+            }
+            return ret;
+        }
+
+        void write(string_writer &out, const enums::enum_map<E, V> &values) const {
+            out.begin_object();
+            for (const auto &[key, value] : values) {
+                out.key(enums::to_string(key));
+                this->write_with_context(out, value);
+            }
+            out.end_object();
+        }
+    };
+
+    template<enums::enumeral E, typename V, typename Context> requires deserializable<V, Context>
+    struct deserializer<enums::enum_map<E, V>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        enums::enum_map<E, V> operator()(const json &value) const {
+            if (!value.is_object()) {
+                throw std::runtime_error(fmt::format("Cannot deserialize {} map: value is not an object", reflect::type_name<E>()));
+            }
+            enums::enum_map<E, V> ret;
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                ret.insert_or_assign(detail::enum_key<E>(it.key()), this->template deserialize_with_context<V>(it.value()));
+            }
+            return ret;
+        }
+
+        deserialize_result<enums::enum_map<E, V>> try_deserialize(const json &value) const {
+            if (!value.is_object()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {} map: value is not an object", reflect::type_name<E>())};
+            }
+            enums::enum_map<E, V> ret;
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                auto key = detail::try_enum_key<E>(it.key());
+                if (!key) {
+                    return std::move(key).error();
+                }
+                auto result = this->template try_deserialize_with_context<V>(it.value());
+                if (!result) {
+                    return std::move(result).error().prepend_path(it.key());
+                }
+                ret.insert_or_assign(*key, std::move(*result));
+            }
+            return ret;
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_object()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {} map: value is not an object", reflect::type_name<E>())};
+            }
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                if (auto key = detail::try_enum_key<E>(it.key()); !key) {
+                    return std::move(key).error();
+                }
+                if (auto error = this->template validate_with_context<V>(it.value())) {
+                    return std::move(*error).prepend_path(it.key());
+                }
+            }
+            return std::nullopt;
+        }
+
+        enums::enum_map<E, V> read(string_reader &in) const {
+            enums::enum_map<E, V> ret;
+            in.begin_object();
+            while (auto key = in.next_key()) {
+                E index = detail::enum_key<E>(*key);
+                ret.insert_or_assign(index, this->template read_with_context<V>(in));
+            }
+            return ret;
+        }
+    };
+
+}
+
+#endif
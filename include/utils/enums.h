@@ -3,8 +3,11 @@
 
 #include <reflect>
 #include <stdexcept>
+#include <algorithm>
+#include <limits>
 
 #include "json_serial.h"
+#include "perfect_hash.h"
 
 namespace enums {
 
@@ -31,6 +34,68 @@ namespace enums {
         return true;
     }
 
+    namespace detail {
+        template<enumeral T>
+        constexpr uint64_t enum_offset(T value, T min) {
+            using wide_type = std::conditional_t<std::is_signed_v<std::underlying_type_t<T>>, int64_t, uint64_t>;
+            return static_cast<uint64_t>(static_cast<wide_type>(value)) - static_cast<uint64_t>(static_cast<wide_type>(min));
+        }
+
+        template<enumeral T>
+        struct enum_index_table {
+            static constexpr const auto &values = enum_values<T>();
+            static constexpr size_t size = values.size();
+
+            static constexpr T min_value = std::ranges::min(values);
+            static constexpr uint64_t range = enum_offset(std::ranges::max(values), min_value) + 1;
+
+            // a dense table is used when holes waste at most a few entries per enumerator
+            static constexpr bool is_dense = range <= 4 * size + 16;
+
+            using index_type = std::conditional_t<(size < std::numeric_limits<uint8_t>::max()), uint8_t,
+                std::conditional_t<(size < std::numeric_limits<uint16_t>::max()), uint16_t, size_t>>;
+
+            // index of every value from min_value, or size for holes
+            static constexpr auto dense = [] {
+                std::array<index_type, is_dense ? range : 0> ret{};
+                if constexpr (is_dense) {
+                    ret.fill(size);
+                    for (size_t i=0; i<size; ++i) {
+                        ret[enum_offset(values[i], min_value)] = static_cast<index_type>(i);
+                    }
+                }
+                return ret;
+            }();
+
+            // values sorted by offset, paired with their index
+            static constexpr auto sorted = [] {
+                std::array<std::pair<uint64_t, index_type>, is_dense ? 0 : size> ret{};
+                if constexpr (!is_dense) {
+                    for (size_t i=0; i<size; ++i) {
+                        ret[i] = { enum_offset(values[i], min_value), static_cast<index_type>(i) };
+                    }
+                    std::ranges::sort(ret);
+                }
+                return ret;
+            }();
+
+            // Returns the index of value, or size if it is not an enumerator
+            static constexpr size_t find(T value) {
+                uint64_t offset = enum_offset(value, min_value);
+                if constexpr (is_dense) {
+                    return offset < range ? dense[offset] : size;
+                } else {
+                    // branchless binary search: the number of steps only depends on size
+                    size_t base = 0;
+                    for (size_t length = size; length > 1; length -= length / 2) {
+                        base = sorted[base + length / 2].first <= offset ? base + length / 2 : base;
+                    }
+                    return sorted[base].first == offset ? sorted[base].second : size;
+                }
+            }
+        };
+    }
+
     template<enumeral T>
     constexpr size_t indexof(T value) {
         constexpr const auto &values = enum_values<T>();
@@ -40,28 +105,43 @@ namespace enums {
                 return result;
             }
         } else {
-            for (size_t i=0; i<values.size(); ++i) {
-                if (values[i] == value) {
-                    return i;
-                }
+            if (size_t result = detail::enum_index_table<T>::find(value); result != values.size()) {
+                return result;
             }
         }
         throw std::out_of_range("invalid enum index");
     }
 
+    template<enumeral T>
+    constexpr bool is_valid_enum(T value) {
+        if constexpr (is_linear_enum<T>()) {
+            return static_cast<size_t>(value) < enum_values<T>().size();
+        } else {
+            return detail::enum_index_table<T>::find(value) != enum_values<T>().size();
+        }
+    }
+
     template<enumeral T>
     constexpr std::string_view to_string(T input) {
         return reflect::enumerators<T>[indexof(input)].second;
     }
 
+    template<enumeral T, typename ISeq> struct build_enum_names;
+    template<enumeral T, size_t ... Is> struct build_enum_names<T, std::index_sequence<Is ...>> {
+        static constexpr std::array<std::string_view, sizeof...(Is)> value { reflect::enumerators<T>[Is].second ... };
+        static constexpr utils::perfect_hash hash{value};
+    };
+
+    template<enumeral T>
+    using enum_names = build_enum_names<T, std::make_index_sequence<reflect::enumerators<T>.size()>>;
+
     template<enumeral T>
     constexpr std::optional<T> from_string(std::string_view str) {
-        for (const auto &[value, name] : reflect::enumerators<T>) {
-            if (name == str) {
-                return static_cast<T>(value);
-            }
+        size_t index = enum_names<T>::hash.find(str);
+        if (index == enum_names<T>::hash.size()) {
+            return std::nullopt;
         }
-        return std::nullopt;
+        return enum_values<T>()[index];
     }
 
     template<enumeral auto ... Values> struct enum_sequence {
@@ -78,7 +158,41 @@ namespace json {
             if (!value.is_string()) {
                 throw std::runtime_error(fmt::format("Cannot deserialize {}: value is not a string", reflect::type_name<T>()));
             }
-            auto str = value.get<std::string>();
+            const auto &str = value.get_ref<const json::string_t &>();
+            if (auto ret = enums::from_string<T>(str)) {
+                return *ret;
+            } else {
+                throw std::runtime_error(fmt::format("Invalid {} value: {}", reflect::type_name<T>(), str));
+            }
+        }
+
+        deserialize_result<T> try_deserialize(const json &value) const {
+            if (!value.is_string()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {}: value is not a string", reflect::type_name<T>())};
+            }
+            const auto &str = value.get_ref<const json::string_t &>();
+            if (auto ret = enums::from_string<T>(str)) {
+                return *ret;
+            }
+            return deserialize_failure{"", fmt::format("Invalid {} value: {}", reflect::type_name<T>(), str)};
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_string()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {}: value is not a string", reflect::type_name<T>())};
+            }
+            const auto &str = value.get_ref<const json::string_t &>();
+            if (!enums::from_string<T>(str)) {
+                return deserialize_failure{"", fmt::format("Invalid {} value: {}", reflect::type_name<T>(), str)};
+            }
+            return std::nullopt;
+        }
+
+        T read(string_reader &in) const {
+            if (in.peek() != string_reader::token_type::string) {
+                throw std::runtime_error(fmt::format("Cannot deserialize {}: value is not a string", reflect::type_name<T>()));
+            }
+            auto str = in.read_string();
             if (auto ret = enums::from_string<T>(str)) {
                 return *ret;
             } else {
@@ -92,6 +206,10 @@ namespace json {
         json operator()(const T &value) const {
             return std::string(enums::to_string(value));
         }
+
+        void write(string_writer &out, const T &value) const {
+            out.write_string(enums::to_string(value));
+        }
     };
 
 }
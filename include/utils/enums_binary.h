@@ -0,0 +1,51 @@
+#ifndef __ENUMS_BINARY_H__
+#define __ENUMS_BINARY_H__
+
+#include "binary_serial.h"
+#include "enum_bitset.h"
+
+namespace binary {
+
+    template<enums::enumeral T, typename Context>
+    struct serializer<T, Context> {
+        void operator()(packer &out, const T &value) const {
+            out.pack_number(static_cast<std::underlying_type_t<T>>(value));
+        }
+    };
+
+    template<enums::enumeral T, typename Context>
+    struct deserializer<T, Context> {
+        T operator()(unpacker &in) const {
+            auto number = in.unpack_number<std::underlying_type_t<T>>();
+            T value = static_cast<T>(number);
+            if (!enums::is_valid_enum(value)) {
+                throw std::runtime_error(fmt::format("Invalid {} value: {}", reflect::type_name<T>(), number));
+            }
+            return value;
+        }
+    };
+
+    template<enums::enumeral T, typename Context>
+    struct serializer<enums::bitset<T>, Context> {
+        void operator()(packer &out, const enums::bitset<T> &value) const {
+            out.pack_uint(value.to_int());
+        }
+    };
+
+    template<enums::enumeral T, typename Context>
+    struct deserializer<enums::bitset<T>, Context> {
+        enums::bitset<T> operator()(unpacker &in) const {
+            auto mask = in.unpack_number<enums::bitset_int>();
+            enums::bitset<T> ret;
+            for (T v : enums::enum_values<T>()) {
+                if (mask & enums::bitset<T>::to_bit(v)) {
+                    ret.add(v);
+                }
+            }
+            return ret;
+        }
+    };
+
+}
+
+#endif
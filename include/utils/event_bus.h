@@ -0,0 +1,238 @@
+#ifndef __EVENT_BUS_H__
+#define __EVENT_BUS_H__
+
+#include "tagged_variant_vector.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace utils {
+
+    template<typename Signature, size_t BufferSize = 4 * sizeof(void *)> class small_function;
+
+    // Move-only callable wrapper which stores small callables inline, falling back to the heap for larger ones
+    template<typename R, typename ... Args, size_t BufferSize>
+    class small_function<R(Args ...), BufferSize> {
+    private:
+        struct vtable_t {
+            R (*invoke)(void *self, Args && ... args);
+            void (*relocate)(void *dst, void *src) noexcept;
+            void (*destroy)(void *self) noexcept;
+        };
+
+        template<typename F>
+        static constexpr bool stored_inline = sizeof(F) <= BufferSize
+            && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<F>;
+
+        template<typename F>
+        static constexpr vtable_t inline_vtable {
+            [](void *self, Args && ... args) -> R {
+                return std::invoke(*static_cast<F *>(self), std::forward<Args>(args) ...);
+            },
+            [](void *dst, void *src) noexcept {
+                new (dst) F(std::move(*static_cast<F *>(src)));
+                static_cast<F *>(src)->~F();
+            },
+            [](void *self) noexcept {
+                static_cast<F *>(self)->~F();
+            }
+        };
+
+        template<typename F>
+        static constexpr vtable_t heap_vtable {
+            [](void *self, Args && ... args) -> R {
+                return std::invoke(**static_cast<F **>(self), std::forward<Args>(args) ...);
+            },
+            [](void *dst, void *src) noexcept {
+                *static_cast<F **>(dst) = *static_cast<F **>(src);
+            },
+            [](void *self) noexcept {
+                delete *static_cast<F **>(self);
+            }
+        };
+
+        alignas(std::max_align_t) mutable std::byte m_buffer[BufferSize];
+        const vtable_t *m_vtable = nullptr;
+
+    public:
+        small_function() = default;
+
+        template<typename Function> requires (!std::same_as<std::remove_cvref_t<Function>, small_function>)
+            && std::is_invocable_r_v<R, std::decay_t<Function> &, Args ...>
+        small_function(Function &&fn) {
+            using F = std::decay_t<Function>;
+            if constexpr (stored_inline<F>) {
+                new (m_buffer) F(std::forward<Function>(fn));
+                m_vtable = &inline_vtable<F>;
+            } else {
+                *reinterpret_cast<F **>(m_buffer) = new F(std::forward<Function>(fn));
+                m_vtable = &heap_vtable<F>;
+            }
+        }
+
+        small_function(small_function &&other) noexcept
+            : m_vtable{std::exchange(other.m_vtable, nullptr)}
+        {
+            if (m_vtable) {
+                m_vtable->relocate(m_buffer, other.m_buffer);
+            }
+        }
+
+        small_function &operator = (small_function &&other) noexcept {
+            if (this != &other) {
+                reset();
+                m_vtable = std::exchange(other.m_vtable, nullptr);
+                if (m_vtable) {
+                    m_vtable->relocate(m_buffer, other.m_buffer);
+                }
+            }
+            return *this;
+        }
+
+        ~small_function() {
+            reset();
+        }
+
+        void reset() {
+            if (m_vtable) {
+                std::exchange(m_vtable, nullptr)->destroy(m_buffer);
+            }
+        }
+
+        explicit operator bool() const {
+            return m_vtable != nullptr;
+        }
+
+        R operator()(Args ... args) const {
+            return m_vtable->invoke(m_buffer, std::forward<Args>(args) ...);
+        }
+    };
+
+    namespace detail {
+        template<typename T> struct handler_signature { using type = void(const T &); };
+        template<> struct handler_signature<void> { using type = void(); };
+    }
+
+    template<typename Variant> class event_bus;
+
+    // Dispatches tagged variant events to the subscribers of their alternative.
+    // Subscribers are kept in one array per alternative, indexed by the tag index, and are called in subscription order.
+    // Handlers must not subscribe or unsubscribe while an event is being published.
+    template<typename ... Ts>
+    class event_bus<tagged_variant<Ts ...>> {
+    public:
+        using variant_type = tagged_variant<Ts ...>;
+        using index_type = tagged_variant_index<variant_type>;
+
+        template<typename T>
+        using handler_type = small_function<typename detail::handler_signature<T>::type>;
+
+        struct subscription {
+            index_type index;
+            size_t id;
+        };
+
+    private:
+        template<typename T>
+        struct subscriber {
+            size_t id;
+            handler_type<T> handler;
+        };
+
+        std::tuple<std::vector<subscriber<typename Ts::type>> ...> m_subscribers;
+        size_t m_next_id = 0;
+
+        // Reused by publish_batch, a nested call takes it and leaves an empty one to the outer call
+        std::vector<const variant_type *> m_batch;
+
+        template<is_tag Tag>
+        auto &subscribers_of(Tag) {
+            return std::get<detail::find_tag_name<variant_type, Tag>::index>(m_subscribers);
+        }
+
+        template<typename Tag, typename ... Payload>
+        void dispatch(Tag tag, const Payload & ... payload) {
+            for (const auto &sub : subscribers_of(tag)) {
+                sub.handler(payload ...);
+            }
+        }
+
+    public:
+        template<tstring Name, typename Function> requires tag_for<tag<Name>, variant_type>
+        subscription subscribe(Function &&fn) {
+            size_t id = m_next_id++;
+            subscribers_of(tag<Name>{}).push_back({ id, std::forward<Function>(fn) });
+            return { index_type{tag<Name>{}}, id };
+        }
+
+        void unsubscribe(subscription sub) {
+            visit_tagged([&](tag_for<variant_type> auto tag) {
+                auto &subscribers = subscribers_of(tag);
+                auto it = std::ranges::find(subscribers, sub.id, &std::ranges::range_value_t<decltype(subscribers)>::id);
+                if (it != subscribers.end()) {
+                    subscribers.erase(it);
+                }
+            }, sub.index);
+        }
+
+        template<tstring Name> requires tag_for<tag<Name>, variant_type>
+        size_t num_subscribers() const {
+            return std::get<detail::find_tag_name<variant_type, tag<Name>>::index>(m_subscribers).size();
+        }
+
+        void publish(const variant_type &event) {
+            visit_tagged([&](tag_for<variant_type> auto tag, const auto & ... payload) {
+                dispatch(tag, payload ...);
+            }, event);
+        }
+
+        // Dispatches every event of one alternative before moving on to the next.
+        // The relative order of events of the same alternative is preserved.
+        // The range must yield references to events that outlive the call.
+        // Handlers may publish on the same bus, including with publish_batch.
+        template<std::ranges::forward_range Range>
+            requires std::is_lvalue_reference_v<std::ranges::range_reference_t<Range>>
+            && std::convertible_to<std::ranges::range_reference_t<Range>, const variant_type &>
+        void publish_batch(Range &&events) {
+            std::array<size_t, sizeof...(Ts) + 1> offsets{};
+            for (const variant_type &event : events) {
+                ++offsets[event.index() + 1];
+            }
+            for (size_t i = 1; i < offsets.size(); ++i) {
+                offsets[i] += offsets[i - 1];
+            }
+            std::vector<const variant_type *> batch = std::exchange(m_batch, {});
+            batch.resize(offsets.back());
+            for (const variant_type &event : events) {
+                batch[offsets[event.index()]++] = &event;
+            }
+            // after scattering, offsets[I] is the end of the group of alternative I
+            [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                ([&] {
+                    using tag_type = typename detail::tagged_variant_tag_at<variant_type, Is>::type;
+                    size_t begin = Is == 0 ? 0 : offsets[Is - 1];
+                    for (size_t i = begin; i < offsets[Is]; ++i) {
+                        if constexpr (std::is_void_v<typename detail::tagged_variant_type_at<variant_type, Is>::type>) {
+                            dispatch(tag_type{});
+                        } else {
+                            dispatch(tag_type{}, std::get<Is>(*batch[i]));
+                        }
+                    }
+                }(), ...);
+            }(std::index_sequence_for<Ts ...>());
+            batch.clear();
+            m_batch = std::move(batch);
+        }
+
+        // Events stored as a tagged_variant_vector are already grouped by alternative
+        void publish_batch(const tagged_variant_vector<variant_type> &events) {
+            events.for_each_batch([&](tag_for<variant_type> auto tag, const auto & ... payload) {
+                dispatch(tag, payload ...);
+            });
+        }
+    };
+
+}
+
+#endif
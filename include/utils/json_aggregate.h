@@ -2,6 +2,8 @@
 #define __JSON_AGGREGATE_H__
 
 #include "json_serial.h"
+#include "perfect_hash.h"
+#include <ranges>
 #include <reflect>
 
 namespace json {
@@ -24,19 +26,119 @@ namespace json {
             return (deserializable<member_type<T, Is>, Context> && ...);
         }(std::make_index_sequence<reflect::size<T>()>());
 
+    template<aggregate T, size_t I>
+    constexpr bool has_default_field = std::is_default_constructible_v<T> || std::is_default_constructible_v<member_type<T, I>>;
+
+    template<aggregate T, size_t I>
+    member_type<T, I> default_field() {
+        static constexpr auto name = reflect::member_name<I, T>();
+        using value_type = member_type<T, I>;
+        if constexpr (std::is_default_constructible_v<T>) {
+            static const T default_value{};
+            return reflect::get<I>(default_value);
+        } else if constexpr (std::is_default_constructible_v<value_type>) {
+            return value_type{};
+        } else {
+            throw std::runtime_error(fmt::format("missing field {}", name));
+        }
+    }
+
+    // Specialize as std::true_type to skip members equal to their default value when serializing T
+    template<typename T> struct omit_defaults : std::false_type {};
+
+    // Pass as context, or derive the context from it, to skip default members in every aggregate
+    struct sparse {};
+
+    template<typename T, typename Context>
+    concept omitting_defaults = omit_defaults<T>::value || std::derived_from<Context, sparse>;
+
+    template<aggregate T> requires (reflect::size<T>() != 0)
+    struct borrows_input<T> : std::bool_constant<[]<size_t ... Is>(std::index_sequence<Is ...>) {
+        return (borrows_input<member_type<T, Is>>::value || ...);
+    }(std::make_index_sequence<reflect::size<T>()>())> {};
+
+    namespace detail {
+        template<typename T, typename ISeq> struct field_tuple;
+
+        template<typename T, size_t ... Is>
+        struct field_tuple<T, std::index_sequence<Is ...>> {
+            using type = std::tuple<std::optional<member_type<T, Is>> ...>;
+        };
+
+        template<typename T> struct is_optional : std::false_type {};
+        template<typename T> struct is_optional<std::optional<T>> : std::true_type {};
+    }
+
     template<aggregate T, typename Context> requires all_fields_serializable<T, Context>
     struct serializer<T, Context> : context_holder<Context> {
         using context_holder<Context>::context_holder;
 
+        template<size_t I>
+        bool skip_field(const T &value) const {
+            if constexpr (omitting_defaults<T, Context> && has_default_field<T, I>) {
+                using value_type = member_type<T, I>;
+                static const value_type default_value = default_field<T, I>();
+                const value_type &field = reflect::get<I>(value);
+                if constexpr (std::ranges::sized_range<const value_type>) {
+                    if (std::ranges::size(field) != std::ranges::size(default_value)) {
+                        return false;
+                    }
+                }
+                return !this->diff_with_context(default_value, field);
+            } else {
+                return false;
+            }
+        }
+
         json operator()(const T &value) const {
-            return [&]<size_t ... Is>(std::index_sequence<Is ...>) {
-                return json::object({
-                    {
-                        reflect::member_name<Is, T>(),
-                        this->template serialize_with_context(reflect::get<Is>(value))
-                    } ... 
-                });
+            if constexpr (omitting_defaults<T, Context>) {
+                json ret = json::object();
+                [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                    ([&] {
+                        if (!skip_field<Is>(value)) {
+                            ret[json::string_t(reflect::member_name<Is, T>())] = this->serialize_with_context(reflect::get<Is>(value));
+                        }
+                    }(), ...);
+                }(std::make_index_sequence<reflect::size<T>()>());
+                return ret;
+            } else {
+                return [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                    return json::object({
+                        {
+                            reflect::member_name<Is, T>(),
+                            this->template serialize_with_context(reflect::get<Is>(value))
+                        } ... 
+                    });
+                }(std::make_index_sequence<reflect::size<T>()>());
+            }
+        }
+
+        void write(string_writer &out, const T &value) const {
+            out.begin_object();
+            [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                ([&] {
+                    if (!skip_field<Is>(value)) {
+                        out.key(reflect::member_name<Is, T>());
+                        this->write_with_context(out, reflect::get<Is>(value));
+                    }
+                }(), ...);
+            }(std::make_index_sequence<reflect::size<T>()>());
+            out.end_object();
+        }
+
+        std::optional<json> diff(const T &old_value, const T &new_value) const {
+            json ret = json::object();
+            [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                ([&] {
+                    if (auto value = this->diff_with_context(reflect::get<Is>(old_value), reflect::get<Is>(new_value))) {
+                        ret[json::string_t(reflect::member_name<Is, T>())] = std::move(*value);
+                    }
+                }(), ...);
             }(std::make_index_sequence<reflect::size<T>()>());
+            if (ret.empty()) {
+                return std::nullopt;
+            }
+            return ret;
         }
     };
 
@@ -44,29 +146,185 @@ namespace json {
     struct deserializer<T, Context> : context_holder<Context> {
         using context_holder<Context>::context_holder;
 
+        using field_tuple = typename detail::field_tuple<T, std::make_index_sequence<reflect::size<T>()>>::type;
+
+        static constexpr auto field_names = []<size_t ... Is>(std::index_sequence<Is ...>) {
+            return utils::perfect_hash(std::array<std::string_view, sizeof...(Is)>{ reflect::member_name<Is, T>() ... });
+        }(std::make_index_sequence<reflect::size<T>()>());
+
         template<size_t I>
-        member_type<T, I> deserialize_field(const json &value) const {
-            static constexpr auto name = reflect::member_name<I, T>();
-            using value_type = member_type<T, I>;
-            if (value.contains(name)) {
-                return this->template deserialize_with_context<value_type>(value[name]);
-            } else if constexpr (std::is_default_constructible_v<T>) {
-                static constexpr T default_value{};
-                return reflect::get<I>(default_value);
-            } else if constexpr (std::is_default_constructible_v<value_type>) {
-                return value_type{};
-            } else {
-                throw std::runtime_error(fmt::format("missing field {}", name));
+        void set_field(field_tuple &fields, const json &value) const {
+            std::get<I>(fields) = this->template deserialize_with_context<member_type<T, I>>(value);
+        }
+
+        template<size_t I>
+        void set_field(field_tuple &fields, json &&value) const {
+            std::get<I>(fields) = this->template deserialize_with_context<member_type<T, I>>(std::move(value));
+        }
+
+        template<size_t I>
+        void set_field(field_tuple &fields, string_reader &in) const {
+            std::get<I>(fields) = this->template read_with_context<member_type<T, I>>(in);
+        }
+
+        template<typename Source>
+        void set_field(size_t index, field_tuple &fields, Source &&source) const {
+            static constexpr auto vtable = []<size_t ... Is>(std::index_sequence<Is ...>) {
+                return std::array<void (deserializer::*)(field_tuple &, Source &&) const, sizeof...(Is)> {
+                    &deserializer::set_field<Is> ...
+                };
+            }(std::make_index_sequence<reflect::size<T>()>());
+            (this->*vtable[index])(fields, std::forward<Source>(source));
+        }
+
+        template<size_t I>
+        std::optional<deserialize_failure> try_set_field(field_tuple &fields, const json &value) const {
+            auto result = this->template try_deserialize_with_context<member_type<T, I>>(value);
+            if (!result) {
+                return std::move(result).error().prepend_path(reflect::member_name<I, T>());
             }
+            std::get<I>(fields) = std::move(*result);
+            return std::nullopt;
         }
 
-        T operator()(const json &value) const {
+        std::optional<deserialize_failure> try_set_field(size_t index, field_tuple &fields, const json &value) const {
+            static constexpr auto vtable = []<size_t ... Is>(std::index_sequence<Is ...>) {
+                return std::array<std::optional<deserialize_failure> (deserializer::*)(field_tuple &, const json &) const, sizeof...(Is)> {
+                    &deserializer::try_set_field<Is> ...
+                };
+            }(std::make_index_sequence<reflect::size<T>()>());
+            return (this->*vtable[index])(fields, value);
+        }
+
+        template<size_t I>
+        std::optional<deserialize_failure> validate_field(const json &value) const {
+            if (auto error = this->template validate_with_context<member_type<T, I>>(value)) {
+                return std::move(*error).prepend_path(reflect::member_name<I, T>());
+            }
+            return std::nullopt;
+        }
+
+        std::optional<deserialize_failure> validate_field(size_t index, const json &value) const {
+            static constexpr auto vtable = []<size_t ... Is>(std::index_sequence<Is ...>) {
+                return std::array<std::optional<deserialize_failure> (deserializer::*)(const json &) const, sizeof...(Is)> {
+                    &deserializer::validate_field<Is> ...
+                };
+            }(std::make_index_sequence<reflect::size<T>()>());
+            return (this->*vtable[index])(value);
+        }
+
+        static std::optional<deserialize_failure> check_required_fields(const std::array<bool, reflect::size<T>()> &present) {
+            std::optional<deserialize_failure> missing;
+            [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                ((missing || has_default_field<T, Is> || present[Is]
+                    || (missing = deserialize_failure{"", fmt::format("missing field {}", reflect::member_name<Is, T>())}, true)), ...);
+            }(std::make_index_sequence<reflect::size<T>()>());
+            return missing;
+        }
+
+        static T build(field_tuple &fields) {
+            return [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                return T{ std::get<Is>(fields) ? std::move(*std::get<Is>(fields)) : default_field<T, Is>() ... };
+            }(std::make_index_sequence<reflect::size<T>()>());
+        }
+
+        template<typename Json>
+        T deserialize_impl(Json &&value) const {
             if (!value.is_object()) {
                 throw std::runtime_error(fmt::format("Cannot deserialize {}: value is not an object", reflect::type_name<T>()));
             }
-            return [&]<size_t ... Is>(std::index_sequence<Is ...>) {
-                return T{ deserialize_field<Is>(value) ... };
+            field_tuple fields;
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                if (size_t index = field_names.find(it.key()); index != field_names.size()) {
+                    set_field(index, fields, std::forward<Json>(it.value()));
+                }
+            }
+            return build(fields);
+        }
+
+        T operator()(const json &value) const {
+            return deserialize_impl(value);
+        }
+
+        T operator()(json &&value) const {
+            return deserialize_impl(std::move(value));
+        }
+
+        deserialize_result<T> try_deserialize(const json &value) const {
+            if (!value.is_object()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {}: value is not an object", reflect::type_name<T>())};
+            }
+            field_tuple fields;
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                if (size_t index = field_names.find(it.key()); index != field_names.size()) {
+                    if (auto error = try_set_field(index, fields, it.value())) {
+                        return std::move(*error);
+                    }
+                }
+            }
+            auto present = [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                return std::array<bool, sizeof...(Is)>{ std::get<Is>(fields).has_value() ... };
             }(std::make_index_sequence<reflect::size<T>()>());
+            if (auto missing = check_required_fields(present)) {
+                return std::move(*missing);
+            }
+            return build(fields);
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_object()) {
+                return deserialize_failure{"", fmt::format("Cannot deserialize {}: value is not an object", reflect::type_name<T>())};
+            }
+            std::array<bool, reflect::size<T>()> present{};
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                if (size_t index = field_names.find(it.key()); index != field_names.size()) {
+                    if (auto error = validate_field(index, it.value())) {
+                        return error;
+                    }
+                    present[index] = true;
+                }
+            }
+            return check_required_fields(present);
+        }
+
+        template<size_t I>
+        void patch_field(T &target, const json &value) const {
+            // null resets a member to its default, except for optionals where diff uses it for nullopt
+            if (value.is_null() && !detail::is_optional<member_type<T, I>>::value) {
+                reflect::get<I>(target) = default_field<T, I>();
+            } else {
+                this->patch_with_context(reflect::get<I>(target), value);
+            }
+        }
+
+        void patch(T &target, const json &value) const {
+            static constexpr auto vtable = []<size_t ... Is>(std::index_sequence<Is ...>) {
+                return std::array<void (deserializer::*)(T &, const json &) const, sizeof...(Is)> {
+                    &deserializer::patch_field<Is> ...
+                };
+            }(std::make_index_sequence<reflect::size<T>()>());
+
+            if (!value.is_object()) {
+                throw std::runtime_error(fmt::format("Cannot deserialize {}: value is not an object", reflect::type_name<T>()));
+            }
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                if (size_t index = field_names.find(it.key()); index != field_names.size()) {
+                    (this->*vtable[index])(target, it.value());
+                }
+            }
+        }
+
+        T read(string_reader &in) const {
+            field_tuple fields;
+            in.begin_object();
+            while (auto key = in.next_key()) {
+                if (size_t index = field_names.find(*key); index != field_names.size()) {
+                    set_field(index, fields, in);
+                } else {
+                    in.skip_value();
+                }
+            }
+            return build(fields);
         }
     };
 
@@ -0,0 +1,149 @@
+#ifndef __JSON_CACHED_H__
+#define __JSON_CACHED_H__
+
+#include "json_serial.h"
+
+#include <mutex>
+#include <typeindex>
+#include <memory>
+
+namespace json {
+
+    // Immutable value whose serialized forms are computed once and reused by every later serialization.
+    // The cache is kept per context type, and only for stateless (empty) contexts or no context:
+    // a context carrying state may change the output, so the value is serialized every time with it.
+    // The text form is spliced into the output as is, while serialize returns a copy of the cached json.
+    template<typename T>
+    class cached {
+    private:
+        struct cache_entry {
+            std::once_flag json_once;
+            json json_value;
+
+            std::once_flag text_once;
+            std::string text;
+        };
+
+        T m_value;
+
+        mutable std::mutex m_mutex;
+        mutable std::vector<std::pair<std::type_index, std::unique_ptr<cache_entry>>> m_entries;
+
+        template<typename Key>
+        cache_entry &entry() const {
+            std::type_index key = typeid(Key);
+            std::scoped_lock lock{m_mutex};
+            auto it = std::ranges::find(m_entries, key, &decltype(m_entries)::value_type::first);
+            if (it == m_entries.end()) {
+                return *m_entries.emplace_back(key, std::make_unique<cache_entry>()).second;
+            }
+            return *it->second;
+        }
+
+    public:
+        cached(T value) : m_value{std::move(value)} {}
+
+        cached(const cached &other) : m_value{other.m_value} {}
+        cached(cached &&other) : m_value{std::move(other.m_value)} {}
+
+        cached &operator = (const cached &) = delete;
+
+        const T &get() const {
+            return m_value;
+        }
+
+        const T &operator *() const {
+            return m_value;
+        }
+
+        const T *operator ->() const {
+            return &m_value;
+        }
+
+        // Returns the json built by fn the first time it is requested for Key
+        template<typename Key, typename Function>
+        const json &get_json(Function &&fn) const {
+            cache_entry &e = entry<Key>();
+            std::call_once(e.json_once, [&]{
+#ifdef USE_JSON_ARENA
+                // the cache outlives any per-request arena
+                arena_scope scope{*std::pmr::new_delete_resource()};
+#endif
+                e.json_value = std::invoke(std::forward<Function>(fn), m_value);
+            });
+            return e.json_value;
+        }
+
+        // Returns the text written by fn the first time it is requested for Key
+        template<typename Key, typename Function>
+        std::string_view get_text(Function &&fn) const {
+            cache_entry &e = entry<Key>();
+            std::call_once(e.text_once, [&]{
+                string_writer out{e.text};
+                std::invoke(std::forward<Function>(fn), out, m_value);
+            });
+            return e.text;
+        }
+    };
+
+    template<typename T> struct borrows_input<cached<T>> : borrows_input<T> {};
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    struct serializer<cached<T>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        static constexpr bool use_cache = std::is_void_v<Context> || std::is_empty_v<Context>;
+
+        json operator()(const cached<T> &value) const {
+            if constexpr (use_cache) {
+                return value.template get_json<Context>([this](const T &value) {
+                    return this->serialize_with_context(value);
+                });
+            } else {
+                return this->serialize_with_context(value.get());
+            }
+        }
+
+        void write(string_writer &out, const cached<T> &value) const {
+            if constexpr (use_cache) {
+                out.write_raw(value.template get_text<Context>([this](string_writer &out, const T &value) {
+                    this->write_with_context(out, value);
+                }));
+            } else {
+                this->write_with_context(out, value.get());
+            }
+        }
+    };
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    struct deserializer<cached<T>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        cached<T> operator()(const json &value) const {
+            return this->template deserialize_with_context<T>(value);
+        }
+
+        cached<T> operator()(json &&value) const {
+            return this->template deserialize_with_context<T>(std::move(value));
+        }
+
+        deserialize_result<cached<T>> try_deserialize(const json &value) const {
+            auto result = this->template try_deserialize_with_context<T>(value);
+            if (!result) {
+                return std::move(result).error();
+            }
+            return cached<T>{std::move(*result)};
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            return this->template validate_with_context<T>(value);
+        }
+
+        cached<T> read(string_reader &in) const {
+            return this->template read_with_context<T>(in);
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef __JSON_LAZY_H__
+#define __JSON_LAZY_H__
+
+#include "json_serial.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace json {
+
+    namespace detail {
+        struct no_mutex {
+            void lock() {}
+            void unlock() {}
+        };
+    }
+
+    // Keeps the raw form of a value and only deserializes it on first access, without a context.
+    // Only deserializing from text or from an rvalue json defers the work: a const json would have to be
+    // copied whole, so the value is deserialized right away instead.
+    // Serializing a lazy value writes the raw form back unchanged.
+    // With Synchronized set, get() can be called concurrently from multiple threads.
+    template<typename T, bool Synchronized = false>
+    class lazy {
+    private:
+        std::variant<std::monostate, json, std::string> m_raw;
+        mutable std::optional<T> m_value;
+        mutable std::conditional_t<Synchronized, std::mutex, detail::no_mutex> m_mutex;
+        mutable std::conditional_t<Synchronized, std::atomic<bool>, bool> m_loaded = false;
+
+        void load() const {
+            if (auto *value = std::get_if<json>(&m_raw)) {
+                m_value.emplace(deserialize<T>(*value));
+            } else if (auto *text = std::get_if<std::string>(&m_raw)) {
+                m_value.emplace(deserialize<T>(std::string_view(*text)));
+            } else if constexpr (std::is_default_constructible_v<T>) {
+                m_value.emplace();
+            } else {
+                throw std::runtime_error("Lazy value is empty");
+            }
+        }
+
+        template<typename, typename> friend struct serializer;
+
+    public:
+        lazy() = default;
+
+        lazy(T value) : m_value{std::move(value)}, m_loaded{true} {}
+
+        explicit lazy(json raw) requires (!std::same_as<T, json>) : m_raw{std::move(raw)} {}
+
+        // text must hold a single json value
+        static lazy from_text(std::string_view text) {
+            lazy ret;
+            ret.m_raw.template emplace<std::string>(text);
+            return ret;
+        }
+
+        lazy(const lazy &other) {
+            std::scoped_lock lock{other.m_mutex};
+            m_raw = other.m_raw;
+            m_value = other.m_value;
+            m_loaded = m_value.has_value();
+        }
+
+        lazy(lazy &&other) {
+            std::scoped_lock lock{other.m_mutex};
+            m_raw = std::move(other.m_raw);
+            m_value = std::move(other.m_value);
+            m_loaded = m_value.has_value();
+        }
+
+        lazy &operator = (lazy other) {
+            std::scoped_lock lock{m_mutex};
+            m_raw = std::move(other.m_raw);
+            m_value = std::move(other.m_value);
+            m_loaded = m_value.has_value();
+            return *this;
+        }
+
+        const T &get() const {
+            if (!m_loaded) {
+                std::scoped_lock lock{m_mutex};
+                if (!m_value) {
+                    load();
+                }
+                m_loaded = true;
+            }
+            return *m_value;
+        }
+
+        const T &operator *() const {
+            return get();
+        }
+
+        const T *operator ->() const {
+            return &get();
+        }
+
+        bool is_loaded() const {
+            return m_loaded;
+        }
+    };
+
+    template<typename T>
+    using synchronized_lazy = lazy<T, true>;
+
+    template<typename T, bool Synchronized, typename Context>
+    struct serializer<lazy<T, Synchronized>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        json operator()(const lazy<T, Synchronized> &value) const {
+            if (auto *raw = std::get_if<json>(&value.m_raw)) {
+                return *raw;
+            } else if (auto *text = std::get_if<std::string>(&value.m_raw)) {
+                return json::parse(*text);
+            } else {
+                return this->serialize_with_context(value.get());
+            }
+        }
+
+        void write(string_writer &out, const lazy<T, Synchronized> &value) const {
+            if (auto *raw = std::get_if<json>(&value.m_raw)) {
+                out.write_json(*raw);
+            } else if (auto *text = std::get_if<std::string>(&value.m_raw)) {
+                out.write_raw(*text);
+            } else {
+                this->write_with_context(out, value.get());
+            }
+        }
+    };
+
+    template<typename T, bool Synchronized, typename Context>
+    struct deserializer<lazy<T, Synchronized>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        lazy<T, Synchronized> operator()(const json &value) const {
+            return lazy<T, Synchronized>{this->template deserialize_with_context<T>(value)};
+        }
+
+        lazy<T, Synchronized> operator()(json &&value) const {
+            return lazy<T, Synchronized>{std::move(value)};
+        }
+
+        deserialize_result<lazy<T, Synchronized>> try_deserialize(const json &value) const {
+            auto result = this->template try_deserialize_with_context<T>(value);
+            if (!result) {
+                return std::move(result).error();
+            }
+            return lazy<T, Synchronized>{std::move(*result)};
+        }
+
+        // Checks the payload eagerly: validation does not build anything
+        std::optional<deserialize_failure> validate(const json &value) const {
+            return this->template validate_with_context<T>(value);
+        }
+
+        lazy<T, Synchronized> read(string_reader &in) const {
+            return lazy<T, Synchronized>::from_text(in.read_raw());
+        }
+    };
+
+}
+
+#endif
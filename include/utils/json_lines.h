@@ -0,0 +1,137 @@
+#ifndef __JSON_LINES_H__
+#define __JSON_LINES_H__
+
+#include "json_serial.h"
+#include "generator.h"
+
+#include <istream>
+#include <ostream>
+
+namespace json {
+
+    namespace detail {
+        inline bool is_blank_line(std::string_view line) {
+            return line.find_first_not_of(" \t\r") == std::string_view::npos;
+        }
+
+        template<typename T, typename Context>
+        T read_line(std::string_view line, size_t line_number, const context_holder<Context> &holder) {
+            try {
+                string_reader in{line};
+                T ret = holder.template read_with_context<T>(in);
+                in.expect_end();
+                return ret;
+            } catch (const std::exception &e) {
+                throw deserialize_error(fmt::format("line {}: {}", line_number, e.what()).c_str());
+            }
+        }
+    }
+
+    // Reads one record per line (NDJSON), reusing a single line buffer, and skips blank lines.
+    // Records must not borrow from the input, since they would point into the line buffer.
+    template<typename T> requires deserializable<T>
+    utils::generator<T> read_lines(std::istream &in) {
+        static_assert(!borrows_input<T>::value, "T would point into the line buffer, which is overwritten by the next line");
+        std::string line;
+        size_t line_number = 0;
+        while (std::getline(in, line)) {
+            ++line_number;
+            if (!detail::is_blank_line(line)) {
+                co_yield detail::read_line<T>(line, line_number, context_holder<void>{});
+            }
+        }
+    }
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    utils::generator<T> read_lines(std::istream &in, Context context) {
+        static_assert(!borrows_input<T>::value, "T would point into the line buffer, which is overwritten by the next line");
+        std::string line;
+        size_t line_number = 0;
+        while (std::getline(in, line)) {
+            ++line_number;
+            if (!detail::is_blank_line(line)) {
+                co_yield detail::read_line<T>(line, line_number, context_holder<Context>{context});
+            }
+        }
+    }
+
+    // Writes one record per line through a reusable buffer, flushed to the stream in large blocks.
+    // The destructor flushes what is left but ignores errors: call flush() to have them thrown.
+    class line_writer {
+    private:
+        std::ostream &m_out;
+        std::string m_buffer;
+        size_t m_flush_size;
+
+        template<typename Function>
+        void write_line(Function &&fn) {
+            size_t begin = m_buffer.size();
+            try {
+                fn(m_buffer);
+            } catch (...) {
+                m_buffer.resize(begin);
+                throw;
+            }
+            m_buffer.push_back('\n');
+            if (m_buffer.size() >= m_flush_size) {
+                flush();
+            }
+        }
+
+    public:
+        explicit line_writer(std::ostream &out, size_t flush_size = 1 << 16)
+            : m_out{out}, m_flush_size{flush_size}
+        {
+            m_buffer.reserve(flush_size);
+        }
+
+        line_writer(const line_writer &) = delete;
+        line_writer &operator = (const line_writer &) = delete;
+
+        ~line_writer() {
+            try {
+                flush();
+            } catch (...) {}
+        }
+
+        template<typename T> requires serializable<T>
+        void write(const T &value) {
+            write_line([&](std::string &buffer) {
+                serialize_to(buffer, value);
+            });
+        }
+
+        template<typename T, typename Context> requires serializable<T, Context>
+        void write(const T &value, const Context &context) {
+            write_line([&](std::string &buffer) {
+                serialize_to(buffer, value, context);
+            });
+        }
+
+        void flush() {
+            m_out.write(m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+        }
+    };
+
+    template<std::ranges::input_range Range> requires serializable<std::ranges::range_value_t<Range>>
+    void write_lines(std::ostream &out, Range &&range) {
+        line_writer writer{out};
+        for (const auto &value : range) {
+            writer.write(value);
+        }
+        writer.flush();
+    }
+
+    template<std::ranges::input_range Range, typename Context> requires serializable<std::ranges::range_value_t<Range>, Context>
+    void write_lines(std::ostream &out, Range &&range, const Context &context) {
+        line_writer writer{out};
+        for (const auto &value : range) {
+            writer.write(value, context);
+        }
+        writer.flush();
+    }
+
+}
+
+#endif
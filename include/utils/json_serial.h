@@ -7,11 +7,123 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <charconv>
+#include <cmath>
 #include <map>
+#include <unordered_map>
+#include <span>
+#include <variant>
+#include <memory_resource>
+#include <thread>
+#include <exception>
+#include <limits>
+#include <utility>
 
 namespace json {
 
+#ifdef USE_JSON_ARENA
+    namespace detail {
+        inline thread_local std::pmr::memory_resource *current_arena = nullptr;
+    }
+
+    // Allocates from the memory resource installed by the innermost arena_scope on this thread.
+    // nlohmann::basic_json default-constructs its allocators, so each block stores its resource
+    // in a header and can be freed after the scope has ended.
+    template<typename T>
+    struct arena_allocator {
+        using value_type = T;
+
+        static constexpr size_t header_size = std::max(sizeof(std::pmr::memory_resource *), alignof(T));
+        static constexpr size_t alignment = std::max(alignof(std::pmr::memory_resource *), alignof(T));
+
+        arena_allocator() = default;
+
+        template<typename U>
+        arena_allocator(const arena_allocator<U> &) {}
+
+        T *allocate(size_t n) {
+            auto *resource = detail::current_arena ? detail::current_arena : std::pmr::new_delete_resource();
+            auto *block = static_cast<std::byte *>(resource->allocate(header_size + n * sizeof(T), alignment));
+            *reinterpret_cast<std::pmr::memory_resource **>(block) = resource;
+            return reinterpret_cast<T *>(block + header_size);
+        }
+
+        void deallocate(T *ptr, size_t n) {
+            auto *block = reinterpret_cast<std::byte *>(ptr) - header_size;
+            auto *resource = *reinterpret_cast<std::pmr::memory_resource **>(block);
+            resource->deallocate(block, header_size + n * sizeof(T), alignment);
+        }
+
+        template<typename U>
+        bool operator == (const arena_allocator<U> &) const {
+            return true;
+        }
+    };
+
+    // While alive, every json node, string and container built on this thread is allocated from resource.
+    // Documents must not outlive the resource: pair with a std::pmr::monotonic_buffer_resource
+    // and release it once per request.
+    class arena_scope {
+    private:
+        std::pmr::memory_resource *m_previous;
+
+    public:
+        explicit arena_scope(std::pmr::memory_resource &resource)
+            : m_previous{std::exchange(detail::current_arena, &resource)} {}
+
+        arena_scope(const arena_scope &) = delete;
+        arena_scope &operator = (const arena_scope &) = delete;
+
+        ~arena_scope() {
+            detail::current_arena = m_previous;
+        }
+    };
+
+#endif
+
+    namespace detail {
+#ifdef USE_JSON_HASHED_OBJECTS
+        struct string_hash {
+            using is_transparent = void;
+
+            size_t operator()(std::string_view str) const {
+                return std::hash<std::string_view>{}(str);
+            }
+        };
+
+        // O(1) key lookup, objects are no longer kept in insertion order.
+        // basic_json reads key_compare to decide whether lookups may use string_view keys
+        template<typename Key, typename T, typename IgnoredLess, typename Allocator>
+        struct object_map : std::unordered_map<Key, T, string_hash, std::equal_to<>, Allocator> {
+            using key_compare = IgnoredLess;
+            using std::unordered_map<Key, T, string_hash, std::equal_to<>, Allocator>::unordered_map;
+        };
+#else
+        template<typename Key, typename T, typename IgnoredLess, typename Allocator>
+        using object_map = nlohmann::ordered_map<Key, T, IgnoredLess, Allocator>;
+#endif
+
+#ifdef USE_JSON_ARENA
+        using string_type = std::basic_string<char, std::char_traits<char>, arena_allocator<char>>;
+
+        template<typename T>
+        using allocator_type = arena_allocator<T>;
+#else
+        using string_type = std::string;
+
+        template<typename T>
+        using allocator_type = std::allocator<T>;
+#endif
+    }
+
+    // With USE_JSON_ARENA, json::string_t is not std::string: dump() and get_ref<json::string_t &>() return
+    // a string using arena_allocator, which must be converted explicitly, as in std::string(value.dump()).
+#if defined(USE_JSON_ARENA) || defined(USE_JSON_HASHED_OBJECTS)
+    using json = nlohmann::basic_json<detail::object_map, std::vector, detail::string_type,
+        bool, std::int64_t, std::uint64_t, double, detail::allocator_type>;
+#else
     using json = nlohmann::ordered_json;
+#endif
 
     template<typename T>
     concept is_complete = requires(T self) { sizeof(self); };
@@ -32,72 +144,1002 @@ namespace json {
     template<typename T, typename Context = void>
     concept deserializable = is_deserializable<T, Context>::value;
 
+    // Specialize as std::true_type for types that point into the json value or text they are read from
+    template<typename T> struct borrows_input : std::false_type {};
+    template<> struct borrows_input<std::string_view> : std::true_type {};
+    template<typename T> struct borrows_input<std::vector<T>> : borrows_input<T> {};
+    template<typename T> struct borrows_input<std::optional<T>> : borrows_input<T> {};
+
     using json_error = json::exception;
 
     struct deserialize_error : json_error {
         deserialize_error(const char *message): json_error(0, message) {}
     };
 
+    struct deserialize_failure {
+        std::string path;
+        std::string message;
+
+        deserialize_failure &&prepend_path(std::string_view token) && {
+            std::string escaped = "/";
+            for (char c : token) {
+                switch (c) {
+                case '~': escaped.append("~0"); break;
+                case '/': escaped.append("~1"); break;
+                default: escaped.push_back(c);
+                }
+            }
+            path.insert(0, escaped);
+            return std::move(*this);
+        }
+
+        deserialize_failure &&prepend_path(size_t index) && {
+            path.insert(0, fmt::format("/{}", index));
+            return std::move(*this);
+        }
+
+        std::string what() const {
+            if (path.empty()) {
+                return message;
+            } else {
+                return fmt::format("{}: {}", path, message);
+            }
+        }
+    };
+
+    // Minimal stand-in for std::expected<T, deserialize_failure>
+    template<typename T>
+    class deserialize_result {
+    private:
+        std::variant<T, deserialize_failure> m_value;
+
+    public:
+        deserialize_result(const T &value) : m_value{std::in_place_index<0>, value} {}
+        deserialize_result(T &&value) : m_value{std::in_place_index<0>, std::move(value)} {}
+        deserialize_result(deserialize_failure failure) : m_value{std::in_place_index<1>, std::move(failure)} {}
+
+        bool has_value() const {
+            return m_value.index() == 0;
+        }
+
+        explicit operator bool() const {
+            return has_value();
+        }
+
+        T &operator *() & { return *std::get_if<0>(&m_value); }
+        const T &operator *() const & { return *std::get_if<0>(&m_value); }
+        T &&operator *() && { return std::move(*std::get_if<0>(&m_value)); }
+
+        T *operator ->() { return std::get_if<0>(&m_value); }
+        const T *operator ->() const { return std::get_if<0>(&m_value); }
+
+        T &value() & {
+            check();
+            return **this;
+        }
+
+        const T &value() const & {
+            check();
+            return **this;
+        }
+
+        T &&value() && {
+            check();
+            return std::move(**this);
+        }
+
+        const deserialize_failure &error() const & { return *std::get_if<1>(&m_value); }
+        deserialize_failure &&error() && { return std::move(*std::get_if<1>(&m_value)); }
+
+    private:
+        void check() const {
+            if (!has_value()) {
+                throw deserialize_error(error().what().c_str());
+            }
+        }
+    };
+
+    class string_writer {
+    private:
+        std::string &m_buffer;
+        bool m_first = true;
+
+        void separator() {
+            if (!m_first) {
+                m_buffer.push_back(',');
+            }
+            m_first = false;
+        }
+
+        void append_escaped(std::string_view str) {
+            static constexpr std::string_view hex_digits = "0123456789abcdef";
+            m_buffer.push_back('"');
+            size_t begin = 0;
+            for (size_t i=0; i<str.size(); ++i) {
+                unsigned char c = str[i];
+                if (c >= 0x20 && c != '"' && c != '\\') {
+                    continue;
+                }
+                m_buffer.append(str.substr(begin, i - begin));
+                begin = i + 1;
+                m_buffer.push_back('\\');
+                switch (c) {
+                case '"':   m_buffer.push_back('"'); break;
+                case '\\':  m_buffer.push_back('\\'); break;
+                case '\b':  m_buffer.push_back('b'); break;
+                case '\f':  m_buffer.push_back('f'); break;
+                case '\n':  m_buffer.push_back('n'); break;
+                case '\r':  m_buffer.push_back('r'); break;
+                case '\t':  m_buffer.push_back('t'); break;
+                default:
+                    m_buffer.append("u00");
+                    m_buffer.push_back(hex_digits[c >> 4]);
+                    m_buffer.push_back(hex_digits[c & 0xf]);
+                }
+            }
+            m_buffer.append(str.substr(begin));
+            m_buffer.push_back('"');
+        }
+
+    public:
+        explicit string_writer(std::string &buffer) : m_buffer{buffer} {}
+
+        std::string &buffer() const {
+            return m_buffer;
+        }
+
+        void begin_object() {
+            separator();
+            m_buffer.push_back('{');
+            m_first = true;
+        }
+
+        void end_object() {
+            m_buffer.push_back('}');
+            m_first = false;
+        }
+
+        void begin_array() {
+            separator();
+            m_buffer.push_back('[');
+            m_first = true;
+        }
+
+        void end_array() {
+            m_buffer.push_back(']');
+            m_first = false;
+        }
+
+        void key(std::string_view name) {
+            separator();
+            append_escaped(name);
+            m_buffer.push_back(':');
+            m_first = true;
+        }
+
+        void write_null() {
+            separator();
+            m_buffer.append("null");
+        }
+
+        void write_bool(bool value) {
+            separator();
+            m_buffer.append(value ? "true" : "false");
+        }
+
+        template<typename T> requires std::is_arithmetic_v<T>
+        void write_number(T value) {
+            if constexpr (std::is_same_v<T, bool>) {
+                write_bool(value);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                if (!std::isfinite(value)) {
+                    write_null();
+                    return;
+                }
+                separator();
+                // json stores every floating point number as a double, widen first so that dump() matches
+                char buf[32];
+                auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), static_cast<double>(value));
+                std::string_view str{buf, end};
+                m_buffer.append(str);
+                if (str.find_first_of(".e") == std::string_view::npos) {
+                    m_buffer.append(".0");
+                }
+            } else {
+                separator();
+                char buf[24];
+                auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+                m_buffer.append(buf, end);
+            }
+        }
+
+        void write_string(std::string_view value) {
+            separator();
+            append_escaped(value);
+        }
+
+        void write_json(const json &value) {
+            separator();
+            m_buffer.append(value.dump());
+        }
+
+        // Appends comma separated values produced by another string_writer
+        void write_raw(std::string_view values) {
+            if (!values.empty()) {
+                separator();
+                m_buffer.append(values);
+            }
+        }
+    };
+
+    class string_reader {
+    public:
+        enum class token_type {
+            null_value,
+            boolean,
+            number,
+            string,
+            object,
+            array,
+            end_of_input
+        };
+
+    private:
+        std::string_view m_text;
+        size_t m_pos = 0;
+        bool m_first = true;
+        bool m_escaped = false;
+        std::string m_scratch;
+        std::pmr::memory_resource *m_arena = nullptr;
+
+        [[noreturn]] void error(std::string_view message) const {
+            throw std::runtime_error(fmt::format("{} at offset {}", message, m_pos));
+        }
+
+        void skip_whitespace() {
+            while (m_pos < m_text.size()) {
+                switch (m_text[m_pos]) {
+                case ' ': case '\t': case '\n': case '\r':
+                    ++m_pos;
+                    break;
+                default:
+                    return;
+                }
+            }
+        }
+
+        char peek_char() {
+            skip_whitespace();
+            if (m_pos >= m_text.size()) {
+                error("Unexpected end of input");
+            }
+            return m_text[m_pos];
+        }
+
+        void expect(char c) {
+            if (peek_char() != c) {
+                error(fmt::format("Expected '{}'", c));
+            }
+            ++m_pos;
+        }
+
+        void expect_literal(std::string_view literal) {
+            skip_whitespace();
+            if (m_text.substr(m_pos, literal.size()) != literal) {
+                error(fmt::format("Expected {}", literal));
+            }
+            m_pos += literal.size();
+        }
+
+        std::string_view scan_number() {
+            skip_whitespace();
+            size_t begin = m_pos;
+            while (m_pos < m_text.size()) {
+                char c = m_text[m_pos];
+                if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                    ++m_pos;
+                } else {
+                    break;
+                }
+            }
+            if (begin == m_pos) {
+                error("Expected number");
+            }
+            return m_text.substr(begin, m_pos - begin);
+        }
+
+        unsigned read_hex4() {
+            if (m_pos + 4 > m_text.size()) {
+                error("Invalid unicode escape");
+            }
+            unsigned value = 0;
+            auto [end, ec] = std::from_chars(m_text.data() + m_pos, m_text.data() + m_pos + 4, value, 16);
+            if (ec != std::errc{} || end != m_text.data() + m_pos + 4) {
+                error("Invalid unicode escape");
+            }
+            m_pos += 4;
+            return value;
+        }
+
+        void append_utf8(std::string &out, unsigned codepoint) {
+            if (codepoint < 0x80) {
+                out.push_back(static_cast<char>(codepoint));
+            } else if (codepoint < 0x800) {
+                out.push_back(static_cast<char>(0xc0 | (codepoint >> 6)));
+                out.push_back(static_cast<char>(0x80 | (codepoint & 0x3f)));
+            } else if (codepoint < 0x10000) {
+                out.push_back(static_cast<char>(0xe0 | (codepoint >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (codepoint & 0x3f)));
+            } else {
+                out.push_back(static_cast<char>(0xf0 | (codepoint >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (codepoint & 0x3f)));
+            }
+        }
+
+        void unescape_string(std::string &out) {
+            while (true) {
+                if (m_pos >= m_text.size()) {
+                    error("Unterminated string");
+                }
+                char c = m_text[m_pos++];
+                if (c == '"') {
+                    return;
+                } else if (c != '\\') {
+                    out.push_back(c);
+                    continue;
+                }
+                if (m_pos >= m_text.size()) {
+                    error("Unterminated string");
+                }
+                switch (m_text[m_pos++]) {
+                case '"':   out.push_back('"'); break;
+                case '\\':  out.push_back('\\'); break;
+                case '/':   out.push_back('/'); break;
+                case 'b':   out.push_back('\b'); break;
+                case 'f':   out.push_back('\f'); break;
+                case 'n':   out.push_back('\n'); break;
+                case 'r':   out.push_back('\r'); break;
+                case 't':   out.push_back('\t'); break;
+                case 'u': {
+                    unsigned codepoint = read_hex4();
+                    if (codepoint >= 0xd800 && codepoint < 0xdc00) {
+                        if (m_text.substr(m_pos, 2) != "\\u") {
+                            error("Invalid surrogate pair");
+                        }
+                        m_pos += 2;
+                        unsigned low = read_hex4();
+                        if (low < 0xdc00 || low >= 0xe000) {
+                            error("Invalid surrogate pair");
+                        }
+                        codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+                    } else if (codepoint >= 0xdc00 && codepoint < 0xe000) {
+                        // a low surrogate without a high one would be encoded as invalid utf-8
+                        error("Invalid surrogate pair");
+                    }
+                    append_utf8(out, codepoint);
+                    break;
+                }
+                default:
+                    error("Invalid escape sequence");
+                }
+            }
+        }
+
+    public:
+        // Strings that can't be borrowed from the input text are copied into arena
+        explicit string_reader(std::string_view text, std::pmr::memory_resource *arena = nullptr)
+            : m_text{text}, m_arena{arena} {}
+
+        size_t position() const {
+            return m_pos;
+        }
+
+        std::pmr::memory_resource *arena() const {
+            return m_arena;
+        }
+
+        // Returns a reader over the same text starting at position, reporting offsets relative to the whole text
+        string_reader at(size_t position) const {
+            string_reader ret{m_text, m_arena};
+            ret.m_pos = position;
+            return ret;
+        }
+
+        token_type peek() {
+            skip_whitespace();
+            if (m_pos >= m_text.size()) {
+                return token_type::end_of_input;
+            }
+            switch (m_text[m_pos]) {
+            case 'n': return token_type::null_value;
+            case 't': case 'f': return token_type::boolean;
+            case '"': return token_type::string;
+            case '{': return token_type::object;
+            case '[': return token_type::array;
+            default: return token_type::number;
+            }
+        }
+
+        void read_null() {
+            expect_literal("null");
+        }
+
+        bool read_bool() {
+            if (peek_char() == 't') {
+                expect_literal("true");
+                return true;
+            } else if (m_text[m_pos] == 'f') {
+                expect_literal("false");
+                return false;
+            }
+            error("Cannot deserialize boolean");
+        }
+
+        template<typename T> requires std::is_arithmetic_v<T>
+        T read_number() {
+            if constexpr (std::is_same_v<T, bool>) {
+                return read_bool();
+            } else {
+                if (peek() != token_type::number) {
+                    error(std::is_integral_v<T> ? "Cannot deserialize integer" : "Cannot deserialize number");
+                }
+                std::string_view str = scan_number();
+                T value{};
+                auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+                if (ec != std::errc{} || end != str.data() + str.size()) {
+                    error(std::is_integral_v<T> ? "Cannot deserialize integer" : "Cannot deserialize number");
+                }
+                return value;
+            }
+        }
+
+        // The returned view points into the input text when the string contains no escape
+        // sequences, otherwise into an internal buffer which is overwritten by the next call.
+        std::string_view read_string() {
+            if (peek_char() != '"') {
+                error("Cannot deserialize string");
+            }
+            size_t begin = ++m_pos;
+            size_t end = m_text.find_first_of("\"\\", begin);
+            if (end == std::string_view::npos) {
+                error("Unterminated string");
+            }
+            if (m_text[end] == '"') {
+                m_pos = end + 1;
+                m_escaped = false;
+                return m_text.substr(begin, end - begin);
+            }
+            m_scratch.assign(m_text.substr(begin, end - begin));
+            m_pos = end;
+            unescape_string(m_scratch);
+            m_escaped = true;
+            return m_scratch;
+        }
+
+        // Returns a view that stays valid as long as the input text and the arena
+        std::string_view read_borrowed_string() {
+            std::string_view str = read_string();
+            if (m_escaped) {
+                auto bytes = store_in_arena(std::as_bytes(std::span(str)));
+                return std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+            }
+            return str;
+        }
+
+        std::span<const std::byte> store_in_arena(std::span<const std::byte> bytes) {
+            if (!m_arena) {
+                error("Cannot borrow value: no arena was provided");
+            }
+            if (bytes.empty()) {
+                return {};
+            }
+            auto *data = static_cast<std::byte *>(m_arena->allocate(bytes.size(), 1));
+            std::ranges::copy(bytes, data);
+            return {data, bytes.size()};
+        }
+
+        void begin_object() {
+            if (peek_char() != '{') {
+                error("Expected object");
+            }
+            ++m_pos;
+            m_first = true;
+        }
+
+        std::optional<std::string_view> next_key() {
+            if (peek_char() == '}') {
+                ++m_pos;
+                m_first = false;
+                return std::nullopt;
+            }
+            if (!m_first) {
+                expect(',');
+            }
+            if (peek_char() != '"') {
+                error("Expected object key");
+            }
+            std::string_view key = read_string();
+            expect(':');
+            m_first = false;
+            return key;
+        }
+
+        void begin_array() {
+            if (peek_char() != '[') {
+                error("Expected array");
+            }
+            ++m_pos;
+            m_first = true;
+        }
+
+        bool next_element() {
+            if (peek_char() == ']') {
+                ++m_pos;
+                m_first = false;
+                return false;
+            }
+            if (!m_first) {
+                expect(',');
+            }
+            m_first = false;
+            return true;
+        }
+
+        // Iterative, so that deeply nested input cannot exhaust the stack
+        void skip_value() {
+            std::vector<bool> open_objects;
+            do {
+                if (!open_objects.empty()) {
+                    bool has_next = open_objects.back() ? next_key().has_value() : next_element();
+                    if (!has_next) {
+                        open_objects.pop_back();
+                        continue;
+                    }
+                }
+                switch (peek()) {
+                case token_type::null_value:
+                    read_null();
+                    break;
+                case token_type::boolean:
+                    read_bool();
+                    break;
+                case token_type::number:
+                    scan_number();
+                    break;
+                case token_type::string:
+                    read_string();
+                    break;
+                case token_type::object:
+                    begin_object();
+                    open_objects.push_back(true);
+                    break;
+                case token_type::array:
+                    begin_array();
+                    open_objects.push_back(false);
+                    break;
+                default:
+                    error("Unexpected end of input");
+                }
+            } while (!open_objects.empty());
+        }
+
+        // Skips the next value and returns its text
+        std::string_view read_raw() {
+            skip_whitespace();
+            size_t begin = m_pos;
+            skip_value();
+            return m_text.substr(begin, m_pos - begin);
+        }
+
+        json read_json() {
+#ifdef USE_JSON_ARENA
+            if (m_arena) {
+                arena_scope scope{*m_arena};
+                return json::parse(read_raw());
+            }
+#endif
+            return json::parse(read_raw());
+        }
+
+        void expect_end() {
+            if (peek() != token_type::end_of_input) {
+                error("Unexpected trailing characters");
+            }
+        }
+    };
+
+    // Pass as context, or derive the context from it, to process large arrays on multiple threads.
+    // The context is shared between threads and must be safe to read concurrently.
+    struct parallel {
+        size_t min_parallel_size = 4096;
+        size_t max_threads = std::thread::hardware_concurrency();
+
+        size_t num_chunks(size_t size) const {
+            if (size < min_parallel_size || max_threads < 2) {
+                return 1;
+            }
+            return std::min(max_threads, size);
+        }
+    };
+
+    namespace detail {
+        // Set while running a chunk, so that nested containers are processed on the thread that owns them
+        inline thread_local bool in_parallel_chunk = false;
+
+        // Calls fn(chunk, begin, end) for num_chunks contiguous slices of [0, size), the first one
+        // on the calling thread. Rethrows the exception of the first failing chunk, in chunk order.
+        template<typename Function>
+        void parallel_for_chunks(size_t num_chunks, size_t size, Function fn) {
+            std::vector<std::exception_ptr> errors(num_chunks);
+            auto run_chunk = [&](size_t chunk) {
+                bool was_in_chunk = std::exchange(in_parallel_chunk, true);
+                try {
+                    fn(chunk, size * chunk / num_chunks, size * (chunk + 1) / num_chunks);
+                } catch (...) {
+                    errors[chunk] = std::current_exception();
+                }
+                in_parallel_chunk = was_in_chunk;
+            };
+            {
+                std::vector<std::jthread> threads;
+                threads.reserve(num_chunks - 1);
+                for (size_t i=1; i<num_chunks; ++i) {
+                    threads.emplace_back(run_chunk, i);
+                }
+                run_chunk(0);
+            }
+            for (const auto &error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+
+        template<typename T>
+        std::vector<T> join_chunks(std::vector<std::vector<T>> &chunks, size_t size) {
+            std::vector<T> ret;
+            ret.reserve(size);
+            for (auto &chunk : chunks) {
+                std::ranges::move(chunk, std::back_inserter(ret));
+            }
+            return ret;
+        }
+    }
+
+    template<typename Context> struct context_holder;
+
+    namespace detail {
+        // Operations shared by every context_holder, which only differ in how they pick the traits for Context
+        template<typename Context>
+        struct context_holder_base {
+            const context_holder<Context> &self() const {
+                return static_cast<const context_holder<Context> &>(*this);
+            }
+
+            template<serializable<Context> T>
+            auto serialize_with_context(const T &value) const {
+                return self().template get_serializer<T>()(value);
+            }
+
+            template<serializable<Context> T>
+            void write_with_context(string_writer &out, const T &value) const {
+                auto s = self().template get_serializer<T>();
+                if constexpr (requires { s.write(out, value); }) {
+                    s.write(out, value);
+                } else {
+                    out.write_json(s(value));
+                }
+            }
+
+            template<serializable<Context> T>
+            std::optional<json> diff_with_context(const T &old_value, const T &new_value) const {
+                auto s = self().template get_serializer<T>();
+                if constexpr (requires { s.diff(old_value, new_value); }) {
+                    return s.diff(old_value, new_value);
+                } else if constexpr (std::equality_comparable<T>) {
+                    if (old_value == new_value) {
+                        return std::nullopt;
+                    }
+                    return s(new_value);
+                } else {
+                    json ret = s(new_value);
+                    if (s(old_value) == ret) {
+                        return std::nullopt;
+                    }
+                    return ret;
+                }
+            }
+
+            template<deserializable<Context> T>
+            auto deserialize_with_context(const json &value) const {
+                return self().template get_deserializer<T>()(value);
+            }
+
+            template<deserializable<Context> T>
+            auto deserialize_with_context(json &&value) const {
+                return self().template get_deserializer<T>()(std::move(value));
+            }
+
+            template<deserializable<Context> T>
+            deserialize_result<T> try_deserialize_with_context(const json &value) const {
+                auto d = self().template get_deserializer<T>();
+                if constexpr (requires { d.try_deserialize(value); }) {
+                    return d.try_deserialize(value);
+                } else {
+                    try {
+                        return d(value);
+                    } catch (const std::exception &e) {
+                        return deserialize_failure{"", e.what()};
+                    }
+                }
+            }
+
+            template<deserializable<Context> T>
+            T read_with_context(string_reader &in) const {
+                auto d = self().template get_deserializer<T>();
+                if constexpr (requires { d.read(in); }) {
+                    return d.read(in);
+                } else {
+                    return d(in.read_json());
+                }
+            }
+
+            template<deserializable<Context> T>
+            std::optional<deserialize_failure> validate_with_context(const json &value) const {
+                auto d = self().template get_deserializer<T>();
+                if constexpr (requires { d.validate(value); }) {
+                    return d.validate(value);
+                } else {
+                    auto result = this->template try_deserialize_with_context<T>(value);
+                    if (!result) {
+                        return std::move(result).error();
+                    }
+                    return std::nullopt;
+                }
+            }
+
+            template<deserializable<Context> T>
+            void patch_with_context(T &target, const json &value) const {
+                auto d = self().template get_deserializer<T>();
+                if constexpr (requires { d.patch(target, value); }) {
+                    d.patch(target, value);
+                } else {
+                    target = d(value);
+                }
+            }
+        };
+    }
+
     template<typename Context>
-    struct context_holder {
+    struct context_holder : detail::context_holder_base<Context> {
         const Context &context;
 
         context_holder(const Context &context) : context(context) {}
 
         template<serializable<Context> T>
-        auto serialize_with_context(const T &value) const {
+        auto get_serializer() const {
             if constexpr (requires { serializer<T, Context>{context}; }) {
-                return serializer<T, Context>{context}(value);
+                return serializer<T, Context>{context};
             } else {
-                return serializer<T, void>{}(value);
+                return serializer<T, void>{};
             }
         }
 
         template<deserializable<Context> T>
-        auto deserialize_with_context(const json &value) const {
+        auto get_deserializer() const {
             if constexpr (requires { deserializer<T, Context>{context}; }) {
-                return deserializer<T, Context>{context}(value);
+                return deserializer<T, Context>{context};
             } else {
-                return deserializer<T, void>{}(value);
+                return deserializer<T, void>{};
+            }
+        }
+
+        size_t parallel_chunks(size_t size) const {
+            if constexpr (std::derived_from<Context, parallel>) {
+                if (detail::in_parallel_chunk) {
+                    return 1;
+                }
+#ifdef USE_JSON_ARENA
+                // arenas are not thread safe, and workers would allocate outside of the caller's arena
+                if (detail::current_arena) {
+                    return 1;
+                }
+#endif
+                return context.num_chunks(size);
+            } else {
+                return 1;
             }
         }
     };
 
-    template<> struct context_holder<void> {
-        template<serializable T>
-        auto serialize_with_context(const T &value) const {
-            return serializer<T, void>{}(value);
+    template<> struct context_holder<void> : detail::context_holder_base<void> {
+        template<serializable T>
+        auto get_serializer() const {
+            return serializer<T, void>{};
+        }
+
+        template<deserializable T>
+        auto get_deserializer() const {
+            return deserializer<T, void>{};
+        }
+
+        size_t parallel_chunks(size_t) const {
+            return 1;
+        }
+    };
+
+    template<typename T> requires serializable<T>
+    json serialize(const T &value) {
+        return serializer<T, void>{}(value);
+    }
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    json serialize(const T &value, const Context &context) {
+        return context_holder<Context>{context}.serialize_with_context(value);
+    }
+
+    template<typename T> requires serializable<T>
+    void serialize_to(std::string &buffer, const T &value) {
+        string_writer out{buffer};
+        context_holder<void>{}.write_with_context(out, value);
+    }
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    void serialize_to(std::string &buffer, const T &value, const Context &context) {
+        string_writer out{buffer};
+        context_holder<Context>{context}.write_with_context(out, value);
+    }
+
+    template<typename T> requires deserializable<T>
+    T deserialize(const json &value) {
+        try {
+            return deserializer<T, void>{}(value);
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    T deserialize(const json &value, const Context &context) {
+        try {
+            return context_holder<Context>{context}.template deserialize_with_context<T>(value);
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    template<typename T> requires deserializable<T>
+    deserialize_result<T> try_deserialize(const json &value) {
+        return context_holder<void>{}.template try_deserialize_with_context<T>(value);
+    }
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    deserialize_result<T> try_deserialize(const json &value, const Context &context) {
+        return context_holder<Context>{context}.template try_deserialize_with_context<T>(value);
+    }
+
+    template<typename T> requires deserializable<T>
+    T deserialize(json &&value) {
+        static_assert(!borrows_input<T>::value, "T would point into a temporary json value, deserialize it from an lvalue");
+        try {
+            return deserializer<T, void>{}(std::move(value));
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    T deserialize(json &&value, const Context &context) {
+        static_assert(!borrows_input<T>::value, "T would point into a temporary json value, deserialize it from an lvalue");
+        try {
+            return context_holder<Context>{context}.template deserialize_with_context<T>(std::move(value));
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    // Checks that value would deserialize into T without building it, returns the first failure if not
+    template<typename T> requires deserializable<T>
+    std::optional<deserialize_failure> validate(const json &value) {
+        return context_holder<void>{}.template validate_with_context<T>(value);
+    }
+
+    template<typename T, typename Context> requires deserializable<T, Context>
+    std::optional<deserialize_failure> validate(const json &value, const Context &context) {
+        return context_holder<Context>{context}.template validate_with_context<T>(value);
+    }
+
+    // Returns a merge-patch turning old_value into new_value, or nullopt if they serialize the same
+    template<typename T> requires serializable<T>
+    std::optional<json> diff(const T &old_value, const T &new_value) {
+        return context_holder<void>{}.diff_with_context(old_value, new_value);
+    }
+
+    template<typename T, typename Context> requires serializable<T, Context>
+    std::optional<json> diff(const T &old_value, const T &new_value, const Context &context) {
+        return context_holder<Context>{context}.diff_with_context(old_value, new_value);
+    }
+
+    // Updates target in place: aggregates follow RFC 7386 merge-patch semantics,
+    // strings and vectors reuse their existing storage
+    template<typename T> requires deserializable<T>
+    void deserialize_into(T &target, const json &patch) {
+        try {
+            context_holder<void>{}.patch_with_context(target, patch);
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
         }
+    }
 
-        template<deserializable T>
-        auto deserialize_with_context(const json &value) const {
-            return deserializer<T, void>{}(value);
+    template<typename T, typename Context> requires deserializable<T, Context>
+    void deserialize_into(T &target, const json &patch, const Context &context) {
+        try {
+            context_holder<Context>{context}.patch_with_context(target, patch);
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
         }
-    };
+    }
 
-    template<typename T> requires serializable<T>
-    json serialize(const T &value) {
-        return serializer<T, void>{}(value);
+    // Applies a patch produced by diff
+    template<typename T> requires deserializable<T>
+    void apply(T &target, const json &patch) {
+        deserialize_into(target, patch);
     }
 
-    template<typename T, typename Context> requires serializable<T, Context>
-    json serialize(const T &value, const Context &context) {
-        return context_holder<Context>{context}.serialize_with_context(value);
+    template<typename T, typename Context> requires deserializable<T, Context>
+    void apply(T &target, const json &patch, const Context &context) {
+        deserialize_into(target, patch, context);
     }
 
     template<typename T> requires deserializable<T>
-    T deserialize(const json &value) {
+    T deserialize(string_reader &in) {
         try {
-            return deserializer<T, void>{}(value);
+            T ret = context_holder<void>{}.template read_with_context<T>(in);
+            in.expect_end();
+            return ret;
         } catch (const std::exception &e) {
             throw deserialize_error(e.what());
         }
     }
 
     template<typename T, typename Context> requires deserializable<T, Context>
-    T deserialize(const json &value, const Context &context) {
+    T deserialize(string_reader &in, const Context &context) {
         try {
-            return context_holder<Context>{context}.template deserialize_with_context<T>(value);
+            T ret = context_holder<Context>{context}.template read_with_context<T>(in);
+            in.expect_end();
+            return ret;
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    // Only an explicit std::string_view is parsed as json text:
+    // std::string and const char * arguments still convert to a json string value
+    template<typename T>
+    concept json_text = std::same_as<T, std::string_view>;
+
+    template<typename T, json_text Text> requires deserializable<T>
+    T deserialize(const Text &text) {
+        try {
+            string_reader in{text};
+            T ret = context_holder<void>{}.template read_with_context<T>(in);
+            in.expect_end();
+            return ret;
+        } catch (const std::exception &e) {
+            throw deserialize_error(e.what());
+        }
+    }
+
+    template<typename T, json_text Text, typename Context> requires deserializable<T, Context>
+    T deserialize(const Text &text, const Context &context) {
+        try {
+            string_reader in{text};
+            T ret = context_holder<Context>{context}.template read_with_context<T>(in);
+            in.expect_end();
+            return ret;
         } catch (const std::exception &e) {
             throw deserialize_error(e.what());
         }
@@ -108,6 +1150,36 @@ namespace json {
         json operator()(const json &value) const {
             return value;
         }
+
+        void write(string_writer &out, const json &value) const {
+            out.write_json(value);
+        }
+
+        std::optional<json> diff(const json &old_value, const json &new_value) const {
+            if (!old_value.is_object() || !new_value.is_object()) {
+                if (old_value == new_value) {
+                    return std::nullopt;
+                }
+                return new_value;
+            }
+            json ret = json::object();
+            for (auto it = old_value.begin(); it != old_value.end(); ++it) {
+                if (!new_value.contains(it.key())) {
+                    ret[it.key()] = nullptr;
+                }
+            }
+            for (auto it = new_value.begin(); it != new_value.end(); ++it) {
+                if (auto old_it = old_value.find(it.key()); old_it == old_value.end()) {
+                    ret[it.key()] = it.value();
+                } else if (auto value = diff(*old_it, it.value())) {
+                    ret[it.key()] = std::move(*value);
+                }
+            }
+            if (ret.empty()) {
+                return std::nullopt;
+            }
+            return ret;
+        }
     };
 
     template<typename T, typename Context> requires std::is_arithmetic_v<T>
@@ -115,6 +1187,10 @@ namespace json {
         json operator()(const T &value) const {
             return value;
         }
+
+        void write(string_writer &out, const T &value) const {
+            out.write_number(value);
+        }
     };
 
     template<typename Context>
@@ -122,6 +1198,21 @@ namespace json {
         json operator()(const std::string &value) const {
             return value;
         }
+
+        void write(string_writer &out, const std::string &value) const {
+            out.write_string(value);
+        }
+    };
+
+    template<typename Context>
+    struct serializer<std::string_view, Context> {
+        json operator()(std::string_view value) const {
+            return value;
+        }
+
+        void write(string_writer &out, std::string_view value) const {
+            out.write_string(value);
+        }
     };
 
     template<typename T, typename Context> requires serializable<T, Context>
@@ -130,12 +1221,57 @@ namespace json {
         
         json operator()(const std::vector<T> &value) const {
             auto ret = json::array();
+            if (size_t num_chunks = this->parallel_chunks(value.size()); num_chunks > 1) {
+                auto &array = *ret.get_ptr<json::array_t*>();
+                array.resize(value.size());
+                detail::parallel_for_chunks(num_chunks, value.size(), [&](size_t, size_t begin, size_t end) {
+                    for (size_t i=begin; i<end; ++i) {
+                        array[i] = this->serialize_with_context(value[i]);
+                    }
+                });
+                return ret;
+            }
             ret.get_ptr<json::array_t*>()->reserve(value.size());
             for (const T &obj : value) {
                 ret.push_back(this->serialize_with_context(obj));
             }
             return ret;
         }
+
+        void write(string_writer &out, const std::vector<T> &value) const {
+            out.begin_array();
+            if (size_t num_chunks = this->parallel_chunks(value.size()); num_chunks > 1) {
+                std::vector<std::string> buffers(num_chunks);
+                detail::parallel_for_chunks(num_chunks, value.size(), [&](size_t chunk, size_t begin, size_t end) {
+                    string_writer chunk_out{buffers[chunk]};
+                    for (size_t i=begin; i<end; ++i) {
+                        this->write_with_context(chunk_out, value[i]);
+                    }
+                });
+                for (const auto &buffer : buffers) {
+                    out.write_raw(buffer);
+                }
+            } else {
+                for (const T &obj : value) {
+                    this->write_with_context(out, obj);
+                }
+            }
+            out.end_array();
+        }
+
+        // Merge-patches cannot address single elements, so any change resends the whole array
+        std::optional<json> diff(const std::vector<T> &old_value, const std::vector<T> &new_value) const {
+            if (old_value.size() == new_value.size()) {
+                bool changed = false;
+                for (size_t i=0; i<new_value.size() && !changed; ++i) {
+                    changed = this->diff_with_context(old_value[i], new_value[i]).has_value();
+                }
+                if (!changed) {
+                    return std::nullopt;
+                }
+            }
+            return (*this)(new_value);
+        }
     };
 
     template<typename Rep, typename Period, typename Context>
@@ -143,6 +1279,10 @@ namespace json {
         json operator()(const std::chrono::duration<Rep, Period> &value) const {
             return value.count();
         }
+
+        void write(string_writer &out, const std::chrono::duration<Rep, Period> &value) const {
+            out.write_number(value.count());
+        }
     };
 
     template<typename T, typename Context> requires serializable<T, Context>
@@ -156,6 +1296,24 @@ namespace json {
                 return json{};
             }
         }
+
+        void write(string_writer &out, const std::optional<T> &value) const {
+            if (value) {
+                this->write_with_context(out, *value);
+            } else {
+                out.write_null();
+            }
+        }
+
+        std::optional<json> diff(const std::optional<T> &old_value, const std::optional<T> &new_value) const {
+            if (old_value && new_value) {
+                return this->diff_with_context(*old_value, *new_value);
+            } else if (old_value || new_value) {
+                return (*this)(new_value);
+            } else {
+                return std::nullopt;
+            }
+        }
     };
     
     template<typename Context>
@@ -163,28 +1321,84 @@ namespace json {
         json operator()(const json &value) const {
             return value;
         }
+
+        json operator()(json &&value) const {
+            return std::move(value);
+        }
+
+        deserialize_result<json> try_deserialize(const json &value) const {
+            return value;
+        }
+
+        std::optional<deserialize_failure> validate(const json &) const {
+            return std::nullopt;
+        }
+
+        json read(string_reader &in) const {
+            return in.read_json();
+        }
+
+        void patch(json &target, const json &value) const {
+            target.merge_patch(value);
+        }
     };
 
     template<typename T, typename Context> requires std::is_arithmetic_v<T>
     struct deserializer<T, Context> {
-        T operator()(const json &value) const {
+        static const char *check_type(const json &value) {
             if constexpr (std::is_same_v<T, bool>) {
                 if (!value.is_boolean()) {
-                    throw std::runtime_error("Cannot deserialize boolean");
+                    return "Cannot deserialize boolean";
                 }
             } else if constexpr (std::is_integral_v<T>) {
                 if (!value.is_number_integer()) {
-                    throw std::runtime_error("Cannot deserialize integer");
+                    return "Cannot deserialize integer";
                 }
             } else {
                 if (!value.is_number()) {
-                    throw std::runtime_error("Cannot deserialize number");
+                    return "Cannot deserialize number";
                 }
             }
+            return nullptr;
+        }
+
+        T operator()(const json &value) const {
+            if (const char *error = check_type(value)) {
+                throw std::runtime_error(error);
+            }
+            return value.get<T>();
+        }
+
+        deserialize_result<T> try_deserialize(const json &value) const {
+            if (const char *error = check_type(value)) {
+                return deserialize_failure{"", error};
+            }
             return value.get<T>();
         }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (const char *error = check_type(value)) {
+                return deserialize_failure{"", error};
+            }
+            return std::nullopt;
+        }
+
+        T read(string_reader &in) const {
+            return in.read_number<T>();
+        }
     };
 
+    namespace detail {
+        inline std::string take_string(std::string &str) {
+            return std::move(str);
+        }
+
+        template<typename String>
+        std::string take_string(String &str) {
+            return std::string(str);
+        }
+    }
+
     template<typename Context>
     struct deserializer<std::string, Context> {
         std::string operator()(const json &value) const {
@@ -193,6 +1407,67 @@ namespace json {
             }
             return value.get<std::string>();
         }
+
+        std::string operator()(json &&value) const {
+            if (!value.is_string()) {
+                throw std::runtime_error("Cannot deserialize string");
+            }
+            return detail::take_string(value.get_ref<json::string_t &>());
+        }
+
+        deserialize_result<std::string> try_deserialize(const json &value) const {
+            if (!value.is_string()) {
+                return deserialize_failure{"", "Cannot deserialize string"};
+            }
+            return value.get<std::string>();
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_string()) {
+                return deserialize_failure{"", "Cannot deserialize string"};
+            }
+            return std::nullopt;
+        }
+
+        std::string read(string_reader &in) const {
+            return std::string(in.read_string());
+        }
+
+        void patch(std::string &target, const json &value) const {
+            if (!value.is_string()) {
+                throw std::runtime_error("Cannot deserialize string");
+            }
+            target.assign(value.get_ref<const json::string_t &>());
+        }
+    };
+
+    // Borrows from the json node or from the input text, which must outlive the result
+    template<typename Context>
+    struct deserializer<std::string_view, Context> {
+        std::string_view operator()(const json &value) const {
+            if (!value.is_string()) {
+                throw std::runtime_error("Cannot deserialize string");
+            }
+            return value.get_ref<const json::string_t &>();
+        }
+
+        deserialize_result<std::string_view> try_deserialize(const json &value) const {
+            if (!value.is_string()) {
+                return deserialize_failure{"", "Cannot deserialize string"};
+            }
+            return std::string_view(value.get_ref<const json::string_t &>());
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_string()) {
+                return deserialize_failure{"", "Cannot deserialize string"};
+            }
+            return std::nullopt;
+        }
+
+        std::string_view read(string_reader &in) const {
+            return in.read_borrowed_string();
+        }
     };
     
     template<typename T, typename Context> requires deserializable<T, Context>
@@ -203,6 +1478,16 @@ namespace json {
             if (!value.is_array()) {
                 throw std::runtime_error("Cannot deserialize vector");
             }
+            if (size_t num_chunks = this->parallel_chunks(value.size()); num_chunks > 1) {
+                std::vector<std::vector<T>> chunks(num_chunks);
+                detail::parallel_for_chunks(num_chunks, value.size(), [&](size_t chunk, size_t begin, size_t end) {
+                    chunks[chunk].reserve(end - begin);
+                    for (size_t i=begin; i<end; ++i) {
+                        chunks[chunk].push_back(this->template deserialize_with_context<T>(value[i]));
+                    }
+                });
+                return detail::join_chunks(chunks, value.size());
+            }
             std::vector<T> ret;
             ret.reserve(value.size());
             for (const auto &obj : value) {
@@ -210,6 +1495,157 @@ namespace json {
             }
             return ret;
         }
+
+        std::vector<T> operator()(json &&value) const {
+            if (!value.is_array()) {
+                throw std::runtime_error("Cannot deserialize vector");
+            }
+            if (size_t num_chunks = this->parallel_chunks(value.size()); num_chunks > 1) {
+                auto &array = value.get_ref<json::array_t &>();
+                std::vector<std::vector<T>> chunks(num_chunks);
+                detail::parallel_for_chunks(num_chunks, array.size(), [&](size_t chunk, size_t begin, size_t end) {
+                    chunks[chunk].reserve(end - begin);
+                    for (size_t i=begin; i<end; ++i) {
+                        chunks[chunk].push_back(this->template deserialize_with_context<T>(std::move(array[i])));
+                    }
+                });
+                return detail::join_chunks(chunks, array.size());
+            }
+            std::vector<T> ret;
+            ret.reserve(value.size());
+            for (auto &obj : value) {
+                ret.push_back(this->template deserialize_with_context<T>(std::move(obj)));
+            }
+            return ret;
+        }
+
+        deserialize_result<std::vector<T>> try_deserialize(const json &value) const {
+            if (!value.is_array()) {
+                return deserialize_failure{"", "Cannot deserialize vector"};
+            }
+            if (size_t num_chunks = this->parallel_chunks(value.size()); num_chunks > 1) {
+                std::vector<std::vector<T>> chunks(num_chunks);
+                std::vector<std::optional<deserialize_failure>> failures(num_chunks);
+                detail::parallel_for_chunks(num_chunks, value.size(), [&](size_t chunk, size_t begin, size_t end) {
+                    chunks[chunk].reserve(end - begin);
+                    for (size_t i=begin; i<end; ++i) {
+                        auto result = this->template try_deserialize_with_context<T>(value[i]);
+                        if (!result) {
+                            failures[chunk] = std::move(result).error().prepend_path(i);
+                            return;
+                        }
+                        chunks[chunk].push_back(std::move(*result));
+                    }
+                });
+                for (auto &failure : failures) {
+                    if (failure) {
+                        return std::move(*failure);
+                    }
+                }
+                return detail::join_chunks(chunks, value.size());
+            }
+            std::vector<T> ret;
+            ret.reserve(value.size());
+            for (size_t i=0; i<value.size(); ++i) {
+                auto result = this->template try_deserialize_with_context<T>(value[i]);
+                if (!result) {
+                    return std::move(result).error().prepend_path(i);
+                }
+                ret.push_back(std::move(*result));
+            }
+            return ret;
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_array()) {
+                return deserialize_failure{"", "Cannot deserialize vector"};
+            }
+            for (size_t i=0; i<value.size(); ++i) {
+                if (auto error = this->template validate_with_context<T>(value[i])) {
+                    return std::move(*error).prepend_path(i);
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::vector<T> read(string_reader &in) const {
+            if constexpr (std::derived_from<Context, parallel>) {
+                // the arena is not thread safe, borrowed values must be read sequentially
+                if (!in.arena() && this->parallel_chunks(std::numeric_limits<size_t>::max()) > 1) {
+                    return read_parallel(in);
+                }
+            }
+            std::vector<T> ret;
+            in.begin_array();
+            while (in.next_element()) {
+                ret.push_back(this->template read_with_context<T>(in));
+            }
+            return ret;
+        }
+
+        // Parses the first min_parallel_size elements directly, so that small arrays are only read once.
+        // Past that, finds where each remaining element starts with a cheap scan and parses them in chunks.
+        // Errors are reported for the first failing element, as in the sequential path:
+        // if the scan fails, the elements before it are still parsed before rethrowing its error.
+        std::vector<T> read_parallel(string_reader &in) const {
+            std::vector<T> ret;
+            std::vector<size_t> offsets;
+            std::exception_ptr scan_error;
+            in.begin_array();
+            try {
+                while (in.next_element()) {
+                    if (ret.size() < this->context.min_parallel_size) {
+                        ret.push_back(this->template read_with_context<T>(in));
+                    } else {
+                        offsets.push_back(in.position());
+                        in.skip_value();
+                    }
+                }
+            } catch (...) {
+                if (offsets.empty()) {
+                    throw;
+                }
+                scan_error = std::current_exception();
+            }
+            if (offsets.empty()) {
+                return ret;
+            }
+            size_t num_chunks = std::min(this->parallel_chunks(ret.size() + offsets.size()), offsets.size());
+            std::vector<std::vector<T>> chunks(num_chunks);
+            detail::parallel_for_chunks(num_chunks, offsets.size(), [&](size_t chunk, size_t begin, size_t end) {
+                chunks[chunk].reserve(end - begin);
+                for (size_t i=begin; i<end; ++i) {
+                    string_reader element = in.at(offsets[i]);
+                    chunks[chunk].push_back(this->template read_with_context<T>(element));
+                }
+            });
+            if (scan_error) {
+                std::rethrow_exception(scan_error);
+            }
+            ret.reserve(ret.size() + offsets.size());
+            for (auto &chunk : chunks) {
+                std::ranges::move(chunk, std::back_inserter(ret));
+            }
+            return ret;
+        }
+
+        // Merge-patches replace arrays whole, so every element is rebuilt from the matching entry:
+        // only the capacity of the vector is reused, and extra elements are removed last.
+        // If an element fails, the elements before it are already replaced and the rest are left untouched.
+        void patch(std::vector<T> &target, const json &value) const {
+            if (!value.is_array()) {
+                throw std::runtime_error("Cannot deserialize vector");
+            }
+            size_t common = std::min(target.size(), value.size());
+            for (size_t i=0; i<common; ++i) {
+                target[i] = this->template deserialize_with_context<T>(value[i]);
+            }
+            target.reserve(value.size());
+            for (size_t i=common; i<value.size(); ++i) {
+                target.push_back(this->template deserialize_with_context<T>(value[i]));
+            }
+            target.erase(target.begin() + value.size(), target.end());
+        }
     };
 
     template<typename Rep, typename Period, typename Context>
@@ -220,6 +1656,24 @@ namespace json {
             }
             return std::chrono::duration<Rep, Period>{value.get<Rep>()};
         }
+
+        deserialize_result<std::chrono::duration<Rep, Period>> try_deserialize(const json &value) const {
+            if (!value.is_number()) {
+                return deserialize_failure{"", "Cannot deserialize duration: value is not a number"};
+            }
+            return std::chrono::duration<Rep, Period>{value.get<Rep>()};
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (!value.is_number()) {
+                return deserialize_failure{"", "Cannot deserialize duration: value is not a number"};
+            }
+            return std::nullopt;
+        }
+
+        std::chrono::duration<Rep, Period> read(string_reader &in) const {
+            return std::chrono::duration<Rep, Period>{in.read_number<Rep>()};
+        }
     };
 
     template<typename T, typename Context> requires deserializable<T, Context>
@@ -233,6 +1687,51 @@ namespace json {
                 return this->template deserialize_with_context<T>(value);
             }
         }
+
+        std::optional<T> operator()(json &&value) const {
+            if (value.is_null()) {
+                return std::nullopt;
+            } else {
+                return this->template deserialize_with_context<T>(std::move(value));
+            }
+        }
+
+        deserialize_result<std::optional<T>> try_deserialize(const json &value) const {
+            if (value.is_null()) {
+                return std::optional<T>{};
+            }
+            auto result = this->template try_deserialize_with_context<T>(value);
+            if (!result) {
+                return std::move(result).error();
+            }
+            return std::optional<T>{std::move(*result)};
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            if (value.is_null()) {
+                return std::nullopt;
+            }
+            return this->template validate_with_context<T>(value);
+        }
+
+        std::optional<T> read(string_reader &in) const {
+            if (in.peek() == string_reader::token_type::null_value) {
+                in.read_null();
+                return std::nullopt;
+            } else {
+                return this->template read_with_context<T>(in);
+            }
+        }
+
+        void patch(std::optional<T> &target, const json &value) const {
+            if (value.is_null()) {
+                target.reset();
+            } else if (target) {
+                this->patch_with_context(*target, value);
+            } else {
+                target.emplace(this->template deserialize_with_context<T>(value));
+            }
+        }
     };
 }
 
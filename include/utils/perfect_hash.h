@@ -0,0 +1,123 @@
+#ifndef __PERFECT_HASH_H__
+#define __PERFECT_HASH_H__
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+
+namespace utils {
+
+    namespace detail {
+        constexpr uint64_t fnv1a_hash(std::string_view str) {
+            uint64_t hash = 0xcbf29ce484222325;
+            for (char c : str) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 0x100000001b3;
+            }
+            return hash;
+        }
+
+        constexpr uint64_t mix_hash(uint64_t hash, uint64_t seed) {
+            hash ^= seed * 0x9e3779b97f4a7c15;
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccd;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53;
+            hash ^= hash >> 33;
+            return hash;
+        }
+    }
+
+    // Maps a fixed set of strings to their index using hash-and-displace:
+    // every lookup hashes the key once and performs at most one string compare.
+    template<size_t Size>
+    class perfect_hash {
+    private:
+        static constexpr size_t table_size = std::bit_ceil(std::max<size_t>(Size, 1));
+        static constexpr size_t mask = table_size - 1;
+        static constexpr uint32_t max_seed = 1 << 20;
+
+        std::array<std::string_view, Size> m_keys{};
+        std::array<uint32_t, table_size> m_seeds{};
+        std::array<size_t, table_size> m_slots{};
+
+    public:
+        constexpr perfect_hash(const std::array<std::string_view, Size> &keys) : m_keys{keys} {
+            std::array<uint64_t, Size> hashes{};
+            std::array<size_t, table_size> bucket_sizes{};
+            for (size_t i=0; i<Size; ++i) {
+                hashes[i] = detail::fnv1a_hash(keys[i]);
+                ++bucket_sizes[hashes[i] & mask];
+            }
+
+            std::array<size_t, table_size> buckets{};
+            for (size_t i=0; i<table_size; ++i) {
+                buckets[i] = i;
+            }
+            std::ranges::sort(buckets, std::ranges::greater{}, [&](size_t bucket) { return bucket_sizes[bucket]; });
+
+            m_slots.fill(Size);
+            for (size_t bucket : buckets) {
+                if (bucket_sizes[bucket] == 0) {
+                    break;
+                }
+
+                for (uint32_t seed = 1; ; ++seed) {
+                    if (seed == max_seed) {
+                        throw "Cannot build perfect hash";
+                    }
+                    std::array<size_t, table_size> taken{};
+                    size_t num_taken = 0;
+                    bool success = true;
+                    for (size_t i=0; i<Size && success; ++i) {
+                        if ((hashes[i] & mask) != bucket) {
+                            continue;
+                        }
+                        size_t slot = detail::mix_hash(hashes[i], seed) & mask;
+                        if (m_slots[slot] != Size || std::ranges::find(taken.begin(), taken.begin() + num_taken, slot) != taken.begin() + num_taken) {
+                            success = false;
+                        } else {
+                            taken[num_taken++] = slot;
+                        }
+                    }
+                    if (success) {
+                        m_seeds[bucket] = seed;
+                        size_t n = 0;
+                        for (size_t i=0; i<Size; ++i) {
+                            if ((hashes[i] & mask) == bucket) {
+                                m_slots[taken[n++]] = i;
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        constexpr size_t size() const {
+            return Size;
+        }
+
+        constexpr const std::array<std::string_view, Size> &keys() const {
+            return m_keys;
+        }
+
+        // Returns the index of key, or size() if it is not part of the set
+        constexpr size_t find(std::string_view key) const {
+            uint64_t hash = detail::fnv1a_hash(key);
+            size_t index = m_slots[detail::mix_hash(hash, m_seeds[hash & mask]) & mask];
+            if (index != Size && m_keys[index] == key) {
+                return index;
+            }
+            return Size;
+        }
+    };
+
+    template<size_t Size>
+    perfect_hash(const std::array<std::string_view, Size> &) -> perfect_hash<Size>;
+
+}
+
+#endif
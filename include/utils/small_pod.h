@@ -49,6 +49,10 @@ namespace json {
         json operator()(const basic_small_string<MaxSize> &value) const {
             return std::string(std::string_view(value));
         }
+
+        void write(string_writer &out, const basic_small_string<MaxSize> &value) const {
+            out.write_string(value);
+        }
     };
 }
 
@@ -197,6 +201,14 @@ namespace json {
             }
             return ret;
         }
+
+        void write(string_writer &out, const small_vector<T, MaxSize> &value) const {
+            out.begin_array();
+            for (const T &obj : value) {
+                this->write_with_context(out, obj);
+            }
+            out.end_array();
+        }
     };
 
     template<typename Context>
@@ -208,6 +220,14 @@ namespace json {
             }
             return ret;
         }
+
+        void write(string_writer &out, small_int_set value) const {
+            out.begin_array();
+            for (int n : value) {
+                out.write_number(n);
+            }
+            out.end_array();
+        }
     };
 }
 
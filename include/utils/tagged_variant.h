@@ -2,8 +2,11 @@
 #define __TAGGED_VARIANT_H__
 
 #include <variant>
+#include <cstdint>
+#include <limits>
 
 #include "tstring.h"
+#include "perfect_hash.h"
 #include "json_serial.h"
 
 namespace utils {
@@ -81,8 +84,19 @@ namespace utils {
             using type = std::tuple_element_t<I, std::tuple<typename Ts::type ...>>;
         };
 
+        template<typename Variant, size_t I> struct tagged_variant_tag_at;
+
+        template<size_t I, typename ... Ts>
+        struct tagged_variant_tag_at<tagged_variant<Ts ...>, I> {
+            using type = tag<std::tuple_element_t<I, std::tuple<Ts ...>>::name>;
+        };
+
         template<typename T> struct is_tagged_variant : std::false_type {};
         template<typename ... Ts> struct is_tagged_variant<tagged_variant<Ts ...>> : std::true_type {};
+
+        template<size_t N>
+        using index_storage_t = std::conditional_t<(N <= std::numeric_limits<uint8_t>::max()), uint8_t,
+            std::conditional_t<(N <= std::numeric_limits<uint16_t>::max()), uint16_t, size_t>>;
     }
 
     template<typename T> struct tagged_variant_tag_names;
@@ -90,6 +104,7 @@ namespace utils {
     template<typename ... Ts>
     struct tagged_variant_tag_names<tagged_variant<Ts ...>> {
         static constexpr std::array value { std::string_view(Ts::name) ... };
+        static constexpr utils::perfect_hash hash{value};
     };
 
     template<typename T>
@@ -115,26 +130,45 @@ namespace utils {
     template<typename Variant>
     class tagged_variant_index {
     private:
-        size_t m_index;
+        // stored in the smallest integer that fits, like the discriminator of std::variant
+        using storage_type = detail::index_storage_t<utils::tagged_variant_tag_names<Variant>::value.size()>;
+        storage_type m_index;
 
     public:
         constexpr tagged_variant_index() = default;
 
         explicit constexpr tagged_variant_index(const Variant &variant)
-            : m_index{variant.index()} {}
+            : m_index{static_cast<storage_type>(variant.index())} {}
 
         explicit constexpr tagged_variant_index(tag_for<Variant> auto tag)
             : m_index{detail::find_tag_name<Variant, decltype(tag)>::index} {}
         
+        static constexpr tagged_variant_index from_index(size_t index) {
+            if (auto ret = from_number(index)) {
+                return *ret;
+            }
+            throw std::runtime_error(fmt::format("Invalid variant index: {}", index));
+        }
+
+        static constexpr std::optional<tagged_variant_index> from_number(size_t index) {
+            if (index >= utils::tagged_variant_tag_names<Variant>::value.size()) {
+                return std::nullopt;
+            }
+            tagged_variant_index ret;
+            ret.m_index = static_cast<storage_type>(index);
+            return ret;
+        }
+
+        static constexpr std::optional<tagged_variant_index> from_string(std::string_view key) {
+            return from_number(utils::tagged_variant_tag_names<Variant>::hash.find(key));
+        }
+
         explicit constexpr tagged_variant_index(std::string_view key) {
-            const auto &tag_names = utils::tagged_variant_tag_names<Variant>::value;
-            for (size_t i=0; i<tag_names.size(); ++i) {
-                if (tag_names[i] == key) {
-                    m_index = i;
-                    return;
-                }
+            if (auto ret = from_string(key)) {
+                m_index = ret->m_index;
+            } else {
+                throw std::runtime_error(fmt::format("Invalid variant type: {}", key));
             }
-            throw std::runtime_error(fmt::format("Invalid variant type: {}", key));
         }
 
         constexpr bool operator == (const tagged_variant_index &other) const = default;
@@ -147,6 +181,9 @@ namespace utils {
             return utils::tagged_variant_tag_names<Variant>::value[index()];
         }
     };
+
+    static_assert(sizeof(tagged_variant_index<tagged_variant<tag<"a">, tag<"b", int>>>) == 1,
+        "tagged_variant_index should fit in one byte for variants with less than 256 alternatives");
     
     template<typename Visitor, typename Variant> struct visit_return_type;
 
@@ -189,28 +226,155 @@ namespace utils {
         using return_type = typename visit_return_type<Visitor, std::remove_cvref_t<Variant>>::type;
         return visit_tagged<return_type>(std::forward<Visitor>(visitor), std::forward<Variant>(variant));
     }
+
+    namespace detail {
+        // tag followed by the payload of alternative I, or just the tag if its type is void
+        template<size_t I, typename Variant>
+        auto tagged_args(Variant &&variant) {
+            using variant_type = std::remove_cvref_t<Variant>;
+            using tag_type = typename tagged_variant_tag_at<variant_type, I>::type;
+            if constexpr (std::is_void_v<typename tagged_variant_type_at<variant_type, I>::type>) {
+                return std::tuple<tag_type>{};
+            } else {
+                using payload_type = decltype(std::get<I>(std::forward<Variant>(variant)));
+                return std::tuple<tag_type, payload_type>{tag_type{}, std::get<I>(std::forward<Variant>(variant))};
+            }
+        }
+
+        template<typename ... Variants>
+        constexpr auto unflatten_index(size_t flat) {
+            constexpr std::array sizes { tagged_variant_tag_names<std::remove_cvref_t<Variants>>::value.size() ... };
+            std::array<size_t, sizeof...(Variants)> ret;
+            for (size_t i = sizes.size(); i-- > 0;) {
+                ret[i] = flat % sizes[i];
+                flat /= sizes[i];
+            }
+            return ret;
+        }
+
+        template<typename RetType, size_t Flat, typename Visitor, typename ... Variants>
+        RetType visit_flat(Visitor &&visitor, Variants && ... variants) {
+            static constexpr auto indices = unflatten_index<Variants ...>(Flat);
+            auto refs = std::forward_as_tuple(std::forward<Variants>(variants) ...);
+            return [&]<size_t ... Is>(std::index_sequence<Is ...>) -> RetType {
+                return std::apply(std::forward<Visitor>(visitor), std::tuple_cat(tagged_args<indices[Is]>(std::get<Is>(std::move(refs))) ...));
+            }(std::index_sequence_for<Variants ...>());
+        }
+    }
+
+    // Visits several variants at once through a single table indexed by the combined alternative indices.
+    // The visitor receives each tag followed by its payload, omitted for void alternatives, in argument order.
+    template<typename RetType, typename Visitor, typename ... Variants>
+        requires (sizeof...(Variants) >= 2) && (is_tagged_variant<std::remove_cvref_t<Variants>> && ...)
+    RetType visit_tagged(Visitor &&visitor, Variants && ... variants) {
+        static constexpr size_t num_combinations = (tagged_variant_tag_names<std::remove_cvref_t<Variants>>::value.size() * ...);
+        static constexpr auto vtable = []<size_t ... Fs>(std::index_sequence<Fs ...>) {
+            return std::array<RetType (*)(Visitor &&, Variants && ...), sizeof...(Fs)> {
+                &detail::visit_flat<RetType, Fs, Visitor, Variants ...> ...
+            };
+        }(std::make_index_sequence<num_combinations>());
+
+        size_t flat = 0;
+        ((flat = flat * tagged_variant_tag_names<std::remove_cvref_t<Variants>>::value.size() + variants.index()), ...);
+        return vtable[flat](std::forward<Visitor>(visitor), std::forward<Variants>(variants) ...);
+    }
+
+    template<typename Visitor, typename ... Variants>
+        requires (sizeof...(Variants) >= 2) && (is_tagged_variant<std::remove_cvref_t<Variants>> && ...)
+    decltype(auto) visit_tagged(Visitor &&visitor, Variants && ... variants) {
+        using return_type = decltype(std::apply(std::declval<Visitor>(), std::tuple_cat(detail::tagged_args<0>(std::declval<Variants>()) ...)));
+        return visit_tagged<return_type>(std::forward<Visitor>(visitor), std::forward<Variants>(variants) ...);
+    }
 }
 
 namespace json {
 
+    // Pass as context, or derive the context from it, to encode tagged variants
+    // as [index, payload] and their indices as integers instead of by name.
+    // Deserializers accept both encodings.
+    struct compact_variants {};
+
+    namespace detail {
+        template<typename Variant>
+        std::optional<utils::tagged_variant_index<Variant>> variant_index_from_number(const json &value) {
+            if (value.is_number_unsigned()) {
+                return utils::tagged_variant_index<Variant>::from_number(value.get<size_t>());
+            } else if (value.is_number_integer() && value.get<int64_t>() >= 0) {
+                return utils::tagged_variant_index<Variant>::from_number(value.get<int64_t>());
+            }
+            return std::nullopt;
+        }
+    }
+
     template<typename Context, typename ... Ts>
-    struct serializer<utils::tagged_variant_index<utils::tagged_variant<Ts ...>>, Context> {
+    struct serializer<utils::tagged_variant_index<utils::tagged_variant<Ts ...>>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
         json operator()(const utils::tagged_variant_index<utils::tagged_variant<Ts ...>> &value) const {
-            return std::string(value.to_string());
+            if constexpr (std::derived_from<Context, compact_variants>) {
+                return value.index();
+            } else {
+                return std::string(value.to_string());
+            }
+        }
+
+        void write(string_writer &out, const utils::tagged_variant_index<utils::tagged_variant<Ts ...>> &value) const {
+            if constexpr (std::derived_from<Context, compact_variants>) {
+                out.write_number(value.index());
+            } else {
+                out.write_string(value.to_string());
+            }
         }
     };
 
     template<typename Context, typename ... Ts>
     struct deserializer<utils::tagged_variant_index<utils::tagged_variant<Ts ...>>, Context> {
         using value_type = utils::tagged_variant_index<utils::tagged_variant<Ts ...>>;
-        value_type operator()(const json &value) const {
+
+        static deserialize_result<value_type> find_index(const json &value) {
+            if (value.is_number_integer()) {
+                if (auto index = detail::variant_index_from_number<utils::tagged_variant<Ts ...>>(value)) {
+                    return *index;
+                }
+                return deserialize_failure{"", fmt::format("Invalid variant index: {}", value.dump())};
+            }
             if (!value.is_string()) {
-                throw std::runtime_error("Cannot deserialize tagged variant index: value is not a string");
+                return deserialize_failure{"", "Cannot deserialize tagged variant index: value is not a string"};
+            }
+            const auto &key = value.get_ref<const json::string_t &>();
+            if (auto index = value_type::from_string(key)) {
+                return *index;
+            }
+            return deserialize_failure{"", fmt::format("Invalid variant type: {}", key)};
+        }
+
+        value_type operator()(const json &value) const {
+            return find_index(value).value();
+        }
+
+        value_type read(string_reader &in) const {
+            if (in.peek() == string_reader::token_type::number) {
+                return value_type::from_index(in.read_number<size_t>());
+            }
+            return value_type{in.read_string()};
+        }
+
+        deserialize_result<value_type> try_deserialize(const json &value) const {
+            return find_index(value);
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            auto result = find_index(value);
+            if (!result) {
+                return std::move(result).error();
             }
-            return value_type{std::string_view(value.get<std::string>())};
+            return std::nullopt;
         }
     };
 
+    template<typename ... Ts>
+    struct borrows_input<utils::tagged_variant<Ts ...>> : std::bool_constant<(borrows_input<typename Ts::type>::value || ...)> {};
+
     template<typename T, typename Context>
     concept void_or_serializable = std::is_void_v<T> || serializable<T, Context>;
     
@@ -220,6 +384,8 @@ namespace json {
 
         using variant_type = utils::tagged_variant<Ts ...>;
 
+        static constexpr bool compact = std::derived_from<Context, compact_variants>;
+
         template<typename T>
         json serialize_args(T &&arg) const {
             return this->serialize_with_context(std::forward<T>(arg));
@@ -229,14 +395,72 @@ namespace json {
             return json::object();
         }
         
-        json operator()(const variant_type &value) const {
-            return utils::visit_tagged([this](utils::tag_for<variant_type> auto tag, auto && ... args) {
+        // Serializes one alternative given its tag and payload, without building the variant
+        template<utils::tag_for<variant_type> Tag, typename ... Args>
+        json serialize_alternative(Tag tag, const Args & ... args) const {
+            if constexpr (compact) {
+                json ret = json::array({ utils::tagged_variant_index<variant_type>(tag).index() });
+                (ret.push_back(this->serialize_with_context(args)), ...);
+                return ret;
+            } else {
                 return json{{
                     std::string_view{tag.name},
-                    serialize_args(std::forward<decltype(args)>(args) ... )
+                    serialize_args(args ...)
                 }};
+            }
+        }
+
+        template<utils::tag_for<variant_type> Tag, typename ... Args>
+        void write_alternative(string_writer &out, Tag tag, const Args & ... args) const {
+            if constexpr (compact) {
+                out.begin_array();
+                out.write_number(utils::tagged_variant_index<variant_type>(tag).index());
+                (this->write_with_context(out, args), ...);
+                out.end_array();
+            } else {
+                out.begin_object();
+                out.key(std::string_view{tag.name});
+                if constexpr (sizeof...(args) == 0) {
+                    out.begin_object();
+                    out.end_object();
+                } else {
+                    this->write_with_context(out, args ...);
+                }
+                out.end_object();
+            }
+        }
+
+        json operator()(const variant_type &value) const {
+            return utils::visit_tagged([this](utils::tag_for<variant_type> auto tag, const auto & ... args) {
+                return serialize_alternative(tag, args ...);
             }, value);
         }
+
+        void write(string_writer &out, const variant_type &value) const {
+            utils::visit_tagged([&](utils::tag_for<variant_type> auto tag, const auto & ... args) {
+                write_alternative(out, tag, args ...);
+            }, value);
+        }
+
+        std::optional<json> diff(const variant_type &old_value, const variant_type &new_value) const {
+            if (old_value.index() != new_value.index()) {
+                return (*this)(new_value);
+            }
+            return utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) -> std::optional<json> {
+                using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
+                if constexpr (std::is_void_v<value_type>) {
+                    return std::nullopt;
+                } else if (auto value = this->diff_with_context(get<tag.name>(old_value), get<tag.name>(new_value))) {
+                    if constexpr (compact) {
+                        return json::array({ new_value.index(), std::move(*value) });
+                    } else {
+                        return json{{ std::string_view{tag.name}, std::move(*value) }};
+                    }
+                } else {
+                    return std::nullopt;
+                }
+            }, utils::tagged_variant_index(new_value));
+        }
     };
 
     template<typename T, typename Context>
@@ -247,26 +471,192 @@ namespace json {
         using context_holder<Context>::context_holder;
 
         using variant_type = utils::tagged_variant<Ts ...>;
-        
-        variant_type operator()(const json &value) const {
+        using index_type = utils::tagged_variant_index<variant_type>;
+
+        template<typename Json>
+        struct alternative {
+            index_type index;
+            Json *payload;
+            bool compact;
+
+            deserialize_failure &&prepend_path(deserialize_failure &&error) const {
+                if (compact) {
+                    return std::move(error).prepend_path(size_t(1));
+                } else {
+                    return std::move(error).prepend_path(index.to_string());
+                }
+            }
+        };
+
+        // Accepts both {"name": payload} and the compact [index] or [index, payload]
+        template<typename Json>
+        static deserialize_result<alternative<Json>> find_alternative(Json &value) {
+            if (value.is_array()) {
+                if (value.empty() || value.size() > 2) {
+                    return deserialize_failure{"", "Cannot deserialize tagged variant: array must contain the index and at most one value"};
+                }
+                if (!value[0].is_number_integer()) {
+                    return deserialize_failure{"", "Cannot deserialize tagged variant: index is not an integer"};
+                }
+                auto index = detail::variant_index_from_number<variant_type>(value[0]);
+                if (!index) {
+                    return deserialize_failure{"", fmt::format("Invalid variant index: {}", value[0].dump())};
+                }
+                return alternative<Json>{*index, value.size() == 2 ? &value[1] : nullptr, true};
+            }
             if (!value.is_object()) {
-                throw std::runtime_error("Cannot deserialize tagged variant: value is not an object");
+                return deserialize_failure{"", "Cannot deserialize tagged variant: value is not an object"};
             }
             if (value.size() != 1) {
-                throw std::runtime_error("Cannot deserialize tagged variant: object must contain only one key");
+                return deserialize_failure{"", "Cannot deserialize tagged variant: object must contain only one key"};
             }
-
             auto key_it = value.begin();
-            utils::tagged_variant_index<variant_type> index{std::string_view(key_it.key())};
-            const json &inner_value = key_it.value();
+            auto index = index_type::from_string(key_it.key());
+            if (!index) {
+                return deserialize_failure{"", fmt::format("Invalid variant type: {}", key_it.key())};
+            }
+            return alternative<Json>{*index, &key_it.value(), false};
+        }
+
+        static deserialize_failure missing_payload() {
+            return deserialize_failure{"", "Cannot deserialize tagged variant: missing value"};
+        }
+
+        template<typename Json>
+        variant_type deserialize_impl(Json &&value) const {
+            auto found = find_alternative(value).value();
             return utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) {
                 using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
                 if constexpr (std::is_void_v<value_type>) {
                     return variant_type{tag};
                 } else {
-                    return variant_type{tag, this->template deserialize_with_context<value_type>(inner_value)};
+                    if (!found.payload) {
+                        throw std::runtime_error(missing_payload().message);
+                    }
+                    return variant_type{tag, this->template deserialize_with_context<value_type>(std::forward<Json>(*found.payload))};
+                }
+            }, found.index);
+        }
+
+        variant_type operator()(const json &value) const {
+            return deserialize_impl(value);
+        }
+
+        variant_type operator()(json &&value) const {
+            return deserialize_impl(std::move(value));
+        }
+
+        deserialize_result<variant_type> try_deserialize(const json &value) const {
+            auto found = find_alternative(value);
+            if (!found) {
+                return std::move(found).error();
+            }
+            return utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) -> deserialize_result<variant_type> {
+                using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
+                if constexpr (std::is_void_v<value_type>) {
+                    return variant_type{tag};
+                } else {
+                    if (!found->payload) {
+                        return missing_payload();
+                    }
+                    auto result = this->template try_deserialize_with_context<value_type>(*found->payload);
+                    if (!result) {
+                        return found->prepend_path(std::move(result).error());
+                    }
+                    return variant_type{tag, std::move(*result)};
+                }
+            }, found->index);
+        }
+
+        std::optional<deserialize_failure> validate(const json &value) const {
+            auto found = find_alternative(value);
+            if (!found) {
+                return std::move(found).error();
+            }
+            return utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) -> std::optional<deserialize_failure> {
+                using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
+                if constexpr (!std::is_void_v<value_type>) {
+                    if (!found->payload) {
+                        return missing_payload();
+                    }
+                    if (auto error = this->template validate_with_context<value_type>(*found->payload)) {
+                        return found->prepend_path(std::move(*error));
+                    }
+                }
+                return std::nullopt;
+            }, found->index);
+        }
+
+        variant_type read_compact(string_reader &in) const {
+            in.begin_array();
+            if (!in.next_element()) {
+                throw std::runtime_error("Cannot deserialize tagged variant: array must contain the index and at most one value");
+            }
+            if (in.peek() != string_reader::token_type::number) {
+                throw std::runtime_error("Cannot deserialize tagged variant: index is not an integer");
+            }
+            auto index = index_type::from_index(in.read_number<size_t>());
+            if (!in.next_element()) {
+                return utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) {
+                    if constexpr (!std::is_void_v<utils::tagged_variant_value_type<variant_type, decltype(tag)>>) {
+                        throw std::runtime_error(missing_payload().message);
+                    }
+                    return variant_type{tag};
+                }, index);
+            }
+            variant_type ret = utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) {
+                using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
+                if constexpr (std::is_void_v<value_type>) {
+                    in.skip_value();
+                    return variant_type{tag};
+                } else {
+                    return variant_type{tag, this->template read_with_context<value_type>(in)};
+                }
+            }, index);
+            if (in.next_element()) {
+                throw std::runtime_error("Cannot deserialize tagged variant: array must contain the index and at most one value");
+            }
+            return ret;
+        }
+
+        variant_type read(string_reader &in) const {
+            if (in.peek() == string_reader::token_type::array) {
+                return read_compact(in);
+            }
+            in.begin_object();
+            auto key = in.next_key();
+            if (!key) {
+                throw std::runtime_error("Cannot deserialize tagged variant: object must contain only one key");
+            }
+            index_type index{*key};
+            variant_type ret = utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) {
+                using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
+                if constexpr (std::is_void_v<value_type>) {
+                    in.skip_value();
+                    return variant_type{tag};
+                } else {
+                    return variant_type{tag, this->template read_with_context<value_type>(in)};
                 }
             }, index);
+            if (in.next_key()) {
+                throw std::runtime_error("Cannot deserialize tagged variant: object must contain only one key");
+            }
+            return ret;
+        }
+
+        // Patches the payload in place when the tag is unchanged, replaces the variant otherwise
+        void patch(variant_type &target, const json &value) const {
+            auto found = find_alternative(value).value();
+            if (found.index != index_type(target) || !found.payload) {
+                target = deserialize_impl(value);
+                return;
+            }
+            utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) {
+                using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
+                if constexpr (!std::is_void_v<value_type>) {
+                    this->patch_with_context(get<tag.name>(target), *found.payload);
+                }
+            }, found.index);
         }
     };
 }
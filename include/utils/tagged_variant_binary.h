@@ -0,0 +1,84 @@
+#ifndef __TAGGED_VARIANT_BINARY_H__
+#define __TAGGED_VARIANT_BINARY_H__
+
+#include "binary_serial.h"
+#include "tagged_variant.h"
+
+namespace binary {
+
+    // Tagged variants are packed as [index] or [index, payload]
+
+    template<typename Context, typename ... Ts>
+    struct serializer<utils::tagged_variant_index<utils::tagged_variant<Ts ...>>, Context> {
+        void operator()(packer &out, const utils::tagged_variant_index<utils::tagged_variant<Ts ...>> &value) const {
+            out.pack_uint(value.index());
+        }
+    };
+
+    template<typename Context, typename ... Ts>
+    struct deserializer<utils::tagged_variant_index<utils::tagged_variant<Ts ...>>, Context> {
+        using value_type = utils::tagged_variant_index<utils::tagged_variant<Ts ...>>;
+        value_type operator()(unpacker &in) const {
+            return value_type::from_index(in.unpack_number<size_t>());
+        }
+    };
+
+    template<typename T, typename Context>
+    concept void_or_serializable = std::is_void_v<T> || serializable<T, Context>;
+
+    template<typename Context, typename ... Ts> requires (void_or_serializable<typename Ts::type, Context> && ...)
+    struct serializer<utils::tagged_variant<Ts ...>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        using variant_type = utils::tagged_variant<Ts ...>;
+
+        void operator()(packer &out, const variant_type &value) const {
+            utils::visit_tagged([&](utils::tag_for<variant_type> auto, const auto & ... args) {
+                out.pack_array(1 + sizeof...(args));
+                out.pack_uint(value.index());
+                (this->pack_with_context(out, args), ...);
+            }, value);
+        }
+    };
+
+    template<typename T, typename Context>
+    concept void_or_deserializable = std::is_void_v<T> || deserializable<T, Context>;
+
+    template<typename Context, typename ... Ts> requires (void_or_deserializable<typename Ts::type, Context> && ...)
+    struct deserializer<utils::tagged_variant<Ts ...>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        using variant_type = utils::tagged_variant<Ts ...>;
+
+        variant_type operator()(unpacker &in) const {
+            if (!in.is_array()) {
+                throw std::runtime_error("Cannot deserialize tagged variant: value is not an array");
+            }
+            size_t size = in.unpack_array();
+            if (size == 0) {
+                throw std::runtime_error("Cannot deserialize tagged variant: missing index");
+            }
+            auto index = utils::tagged_variant_index<variant_type>::from_index(in.unpack_number<size_t>());
+            size_t consumed = 1;
+            variant_type ret = utils::visit_tagged([&](utils::tag_for<variant_type> auto tag) {
+                using value_type = utils::tagged_variant_value_type<variant_type, decltype(tag)>;
+                if constexpr (std::is_void_v<value_type>) {
+                    return variant_type{tag};
+                } else {
+                    if (size < 2) {
+                        throw std::runtime_error(fmt::format("Cannot deserialize tagged variant: missing value for {}", std::string_view(tag.name)));
+                    }
+                    ++consumed;
+                    return variant_type{tag, this->template unpack_with_context<value_type>(in)};
+                }
+            }, index);
+            for (; consumed < size; ++consumed) {
+                in.skip();
+            }
+            return ret;
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef __TAGGED_VARIANT_VECTOR_H__
+#define __TAGGED_VARIANT_VECTOR_H__
+
+#include "tagged_variant.h"
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <vector>
+
+namespace utils {
+
+    namespace detail {
+        // Alternatives without a payload only need to be counted
+        struct void_payloads {
+            size_t count = 0;
+
+            size_t size() const { return count; }
+            void push_back(std::monostate) { ++count; }
+            void pop_back() { --count; }
+            void clear() { count = 0; }
+            void reserve(size_t) {}
+        };
+
+        template<typename T>
+        using payload_vector = std::conditional_t<std::is_void_v<T>, void_payloads, std::vector<T>>;
+    }
+
+    template<typename Variant> class tagged_variant_vector;
+
+    // Sequence of tagged variants stored as a structure of arrays:
+    // the payloads of each alternative are kept contiguous, plus the index of each element recording their order.
+    // Positions inside the payload arrays are not stored, so sequential traversal is the fast path
+    // and at() needs to count the earlier elements of the same alternative.
+    template<typename ... Ts>
+    class tagged_variant_vector<tagged_variant<Ts ...>> {
+    public:
+        using variant_type = tagged_variant<Ts ...>;
+        using index_type = tagged_variant_index<variant_type>;
+
+    private:
+        std::vector<index_type> m_indices;
+        std::tuple<detail::payload_vector<typename Ts::type> ...> m_payloads;
+
+        template<size_t I>
+        auto &payloads() { return std::get<I>(m_payloads); }
+
+        template<size_t I>
+        const auto &payloads() const { return std::get<I>(m_payloads); }
+
+        template<size_t I, typename ... Args>
+        void emplace_at(Args && ... args) {
+            auto &values = payloads<I>();
+            m_indices.push_back(index_type::from_index(I));
+            try {
+                if constexpr (std::is_void_v<typename detail::tagged_variant_type_at<variant_type, I>::type>) {
+                    values.push_back(std::monostate{});
+                } else {
+                    values.emplace_back(std::forward<Args>(args) ...);
+                }
+            } catch (...) {
+                m_indices.pop_back();
+                throw;
+            }
+        }
+
+        template<typename Variant>
+        void push_variant(Variant &&value) {
+            static constexpr auto vtable = []<size_t ... Is>(std::index_sequence<Is ...>) {
+                return std::array<void (*)(tagged_variant_vector &, Variant &&), sizeof...(Is)> {
+                    [](tagged_variant_vector &self, Variant &&value) {
+                        if constexpr (std::is_void_v<typename detail::tagged_variant_type_at<variant_type, Is>::type>) {
+                            self.emplace_at<Is>();
+                        } else {
+                            self.emplace_at<Is>(std::get<Is>(std::forward<Variant>(value)));
+                        }
+                    } ...
+                };
+            }(std::index_sequence_for<Ts ...>());
+            vtable[value.index()](*this, std::forward<Variant>(value));
+        }
+
+    public:
+        size_t size() const {
+            return m_indices.size();
+        }
+
+        bool empty() const {
+            return m_indices.empty();
+        }
+
+        void reserve(size_t size) {
+            m_indices.reserve(size);
+        }
+
+        // Reserves room for count payloads of the alternative named Name
+        template<tstring Name> requires tag_for<tag<Name>, variant_type>
+        void reserve(size_t count) {
+            payloads<detail::find_tag_name<variant_type, tag<Name>>::index>().reserve(count);
+        }
+
+        void clear() {
+            m_indices.clear();
+            std::apply([](auto & ... values) { (values.clear(), ...); }, m_payloads);
+        }
+
+        void push_back(const variant_type &value) {
+            push_variant(value);
+        }
+
+        void push_back(variant_type &&value) {
+            push_variant(std::move(value));
+        }
+
+        template<is_tag Tag, typename ... Args> requires tag_for<Tag, variant_type>
+        void emplace_back(Tag, Args && ... args) {
+            emplace_at<detail::find_tag_name<variant_type, Tag>::index>(std::forward<Args>(args) ...);
+        }
+
+        index_type index(size_t pos) const {
+            return m_indices[pos];
+        }
+
+        // Rebuilds the element at pos as a tagged_variant, in time linear in pos
+        variant_type at(size_t pos) const {
+            index_type index = m_indices.at(pos);
+            return visit_tagged<variant_type>([&](tag_for<variant_type> auto tag) {
+                static constexpr size_t I = detail::find_tag_name<variant_type, decltype(tag)>::index;
+                if constexpr (std::is_void_v<tagged_variant_value_type<variant_type, decltype(tag)>>) {
+                    return variant_type{tag};
+                } else {
+                    size_t position = std::ranges::count(m_indices.begin(), m_indices.begin() + pos, index);
+                    return variant_type{tag, payloads<I>()[position]};
+                }
+            }, index);
+        }
+
+        variant_type operator[](size_t pos) const {
+            return at(pos);
+        }
+
+        // Contiguous payloads of the alternative named Name, in insertion order
+        template<tstring Name> requires tag_for<tag<Name>, variant_type>
+            && (!std::is_void_v<tagged_variant_value_type<variant_type, tag<Name>>>)
+        std::span<const tagged_variant_value_type<variant_type, tag<Name>>> alternative() const {
+            return payloads<detail::find_tag_name<variant_type, tag<Name>>::index>();
+        }
+
+        template<tstring Name> requires tag_for<tag<Name>, variant_type>
+            && (!std::is_void_v<tagged_variant_value_type<variant_type, tag<Name>>>)
+        std::span<tagged_variant_value_type<variant_type, tag<Name>>> alternative() {
+            return payloads<detail::find_tag_name<variant_type, tag<Name>>::index>();
+        }
+
+        template<tstring Name> requires tag_for<tag<Name>, variant_type>
+        size_t count() const {
+            return payloads<detail::find_tag_name<variant_type, tag<Name>>::index>().size();
+        }
+
+        // Calls visitor(tag, payload) or visitor(tag) on every element, one alternative after the other.
+        // Elements of the same alternative are visited in insertion order, but alternatives are not interleaved.
+        template<typename Visitor>
+        void for_each_batch(Visitor &&visitor) const {
+            [&]<size_t ... Is>(std::index_sequence<Is ...>) {
+                ([&] {
+                    using tag_type = tag<std::tuple_element_t<Is, std::tuple<Ts ...>>::name>;
+                    const auto &values = payloads<Is>();
+                    if constexpr (std::is_void_v<typename detail::tagged_variant_type_at<variant_type, Is>::type>) {
+                        for (size_t i = 0; i < values.size(); ++i) {
+                            std::invoke(visitor, tag_type{});
+                        }
+                    } else {
+                        for (const auto &value : values) {
+                            std::invoke(visitor, tag_type{}, value);
+                        }
+                    }
+                }(), ...);
+            }(std::index_sequence_for<Ts ...>());
+        }
+
+        // Calls visitor(tag, payload) or visitor(tag) on every element in insertion order
+        template<typename Visitor>
+        void for_each(Visitor &&visitor) const {
+            std::array<size_t, sizeof...(Ts)> positions{};
+            for (index_type index : m_indices) {
+                visit_tagged<void>([&](tag_for<variant_type> auto tag) {
+                    static constexpr size_t I = detail::find_tag_name<variant_type, decltype(tag)>::index;
+                    size_t position = positions[I]++;
+                    if constexpr (std::is_void_v<tagged_variant_value_type<variant_type, decltype(tag)>>) {
+                        std::invoke(visitor, tag);
+                    } else {
+                        std::invoke(visitor, tag, payloads<I>()[position]);
+                    }
+                }, index);
+            }
+        }
+    };
+
+    template<typename Visitor, typename ... Ts>
+    void visit_tagged(Visitor &&visitor, const tagged_variant_vector<tagged_variant<Ts ...>> &values) {
+        values.for_each_batch(std::forward<Visitor>(visitor));
+    }
+}
+
+namespace json {
+
+    template<typename Variant> struct borrows_input<utils::tagged_variant_vector<Variant>> : borrows_input<Variant> {};
+
+    template<typename Context, typename ... Ts> requires serializable<utils::tagged_variant<Ts ...>, Context>
+    struct serializer<utils::tagged_variant_vector<utils::tagged_variant<Ts ...>>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        using variant_type = utils::tagged_variant<Ts ...>;
+
+        // Payloads are serialized in place, without rebuilding each element as a tagged_variant
+        json operator()(const utils::tagged_variant_vector<variant_type> &values) const {
+            auto s = this->template get_serializer<variant_type>();
+            json ret = json::array();
+            values.for_each([&](utils::tag_for<variant_type> auto tag, const auto & ... payload) {
+                ret.push_back(s.serialize_alternative(tag, payload ...));
+            });
+            return ret;
+        }
+
+        void write(string_writer &out, const utils::tagged_variant_vector<variant_type> &values) const {
+            auto s = this->template get_serializer<variant_type>();
+            out.begin_array();
+            values.for_each([&](utils::tag_for<variant_type> auto tag, const auto & ... payload) {
+                s.write_alternative(out, tag, payload ...);
+            });
+            out.end_array();
+        }
+    };
+
+    template<typename Context, typename ... Ts> requires deserializable<utils::tagged_variant<Ts ...>, Context>
+    struct deserializer<utils::tagged_variant_vector<utils::tagged_variant<Ts ...>>, Context> : context_holder<Context> {
+        using context_holder<Context>::context_holder;
+
+        using variant_type = utils::tagged_variant<Ts ...>;
+
+        utils::tagged_variant_vector<variant_type> operator()(const json &value) const {
+            if (!value.is_array()) {
+                throw std::runtime_error("Cannot deserialize tagged variant vector: value is not an array");
+            }
+            utils::tagged_variant_vector<variant_type> ret;
+            ret.reserve(value.size());
+            for (const json &element : value) {
+                ret.push_back(this->template deserialize_with_context<variant_type>(element));
+            }
+            return ret;
+        }
+
+        utils::tagged_variant_vector<variant_type> read(string_reader &in) const {
+            utils::tagged_variant_vector<variant_type> ret;
+            in.begin_array();
+            while (in.next_element()) {
+                ret.push_back(this->template read_with_context<variant_type>(in));
+            }
+            return ret;
+        }
+    };
+
+}
+
+#endif